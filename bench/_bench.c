@@ -0,0 +1,65 @@
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Minimal time every measurement is repeated for, in nanoseconds. Override
+ * with `-DB_MIN_NS=...` for quicker (noisier) or slower (steadier) runs.
+ */
+#ifndef B_MIN_NS
+#  define B_MIN_NS 20000000ULL
+#endif // B_MIN_NS
+
+#define B_FATAL(format, ...) do {               \
+        fprintf(stderr, "FATAL: " format "\n", ##__VA_ARGS__);  \
+        exit(1);                                \
+    } while(0)
+
+/**
+ * Prevents the compiler from optimizing away computations that produce `x`
+ * or memory it points to.
+ */
+#define B_KEEP(x) __asm__ __volatile__("" : : "g"(x) : "memory")
+
+uint64_t b_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Prints the CSV header of the reported rows (see b_report()).
+ */
+void b_header(void) {
+    printf("bench,op,cap,layout,size,iters,ns_per_op,gb_per_s\n");
+}
+
+/**
+ * Prints a CSV row for `iters` operations of benchmark `bench` that took `ns`
+ * nanoseconds in total, each processing `size` bytes.
+ */
+void b_report(const char *bench, const char *op, size_t cap, const char *layout,
+              size_t size, uint64_t iters, uint64_t ns) {
+    double ns_per_op = (double)ns / iters;
+    double gb_per_s = (double)size * iters / ns;
+    printf("%s,%s,%zu,%s,%zu,%" PRIu64 ",%.3f,%.3f\n", bench, op, cap, layout, size, iters, ns_per_op, gb_per_s);
+    fflush(stdout);
+}
+
+/**
+ * Repeats `body` with a doubling number of iterations until it runs for at
+ * least `B_MIN_NS`, then reports it (see b_report()). `body` may use `it`,
+ * the index of the current iteration.
+ */
+#define B_MEASURE(bench, op, cap, layout, size, body) do {             \
+        uint64_t _iters = 1, _ns;                                   \
+        for (;;) {                                                  \
+            uint64_t _start = b_now_ns();                           \
+            for (uint64_t it = 0; it < _iters; it++) { body; }      \
+            _ns = b_now_ns() - _start;                              \
+            if (_ns >= B_MIN_NS) break;                             \
+            _iters *= 2;                                            \
+        }                                                           \
+        b_report((bench), (op), (cap), (layout), (size), _iters, _ns); \
+    } while(0)
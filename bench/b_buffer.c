@@ -0,0 +1,118 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_IMPL
+#include "../io.h"
+#include "_bench.c"
+
+static const size_t B_CAPS[] = {64, 4 << 10, 64 << 10, 1 << 20};
+static const size_t B_SIZES[] = {1, 16, 256, 4 << 10, 64 << 10, 1 << 20};
+
+#define B_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+#define B_STATIC_CAP (4 << 10)
+IO_BUFFER_STATIC(B_StaticBuffer, B_STATIC_CAP)
+
+/**
+ * Places `n` bytes of data into IO buffer `b`: starting at the beginning of
+ * the storage, or so that half of it wraps around if `wrapped` is set.
+ */
+static inline void b_layout(IO_Buffer *b, size_t n, bool wrapped) {
+    size_t size = b->cap + 1;
+    size_t start = wrapped ? size - (n + 1) / 2 : 0;
+    size_t end = start + n;
+    if (end >= size) end -= size;
+    b->start = b->buf + start;
+    b->end = b->buf + end;
+}
+
+/**
+ * Same as b_layout(), for the fixed-capacity buffer `b`.
+ */
+static inline void b_static_layout(B_StaticBuffer *b, size_t n, bool wrapped) {
+    b->head = wrapped ? B_STATIC_CAP - (n + 1) / 2 : 0;
+    b->tail = b->head + n;
+}
+
+int main(void) {
+    char *src = malloc(1 << 20), *dest = malloc(1 << 20);
+    if (src == NULL || dest == NULL) B_FATAL("Failed to allocate memory");
+    memset(src, 'x', 1 << 20);
+
+    b_header();
+    for (size_t c = 0; c < B_LEN(B_CAPS); c++) {
+        IO_Buffer b;
+        size_t cap = B_CAPS[c];
+        if (io_buffer_init(&b, cap) != IO_ERR_OK) B_FATAL("Failed to initialize buffer");
+        memset(b.buf, 'y', cap + 1);
+
+        for (int w = 0; w < 2; w++) {
+            bool wrapped = w == 1;
+            const char *layout = wrapped ? "wrapped" : "contiguous";
+            for (size_t i = 0; i < B_LEN(B_SIZES); i++) {
+                size_t n = B_SIZES[i];
+                if (n > cap) break;
+
+                B_MEASURE("buffer", "append", cap, layout, n, {
+                    b_layout(&b, 0, wrapped);
+                    if (wrapped) b.start = b.end = b.buf + (cap + 1) - (n + 1) / 2;
+                    io_buffer_append(&b, src, n);
+                    B_KEEP(b.end);
+                });
+                B_MEASURE("buffer", "nspit", cap, layout, n, {
+                    b_layout(&b, n, wrapped);
+                    io_buffer_nspit(&b, dest, n);
+                    B_KEEP(dest);
+                });
+                B_MEASURE("buffer", "nadvance", cap, layout, n, {
+                    b_layout(&b, n, wrapped);
+                    B_KEEP(io_buffer_nadvance(&b, n));
+                });
+
+                // NOTE: io_buffer_at() is a per-byte access, so an operation
+                //       is a scan over all `n` bytes.
+                b_layout(&b, n, wrapped);
+                B_MEASURE("buffer", "at_scan", cap, layout, n, {
+                    unsigned sum = 0;
+                    for (size_t j = 0; j < n; j++) sum += (unsigned char)io_buffer_at(&b, j);
+                    B_KEEP(sum);
+                });
+                B_MEASURE("buffer", "find_byte", cap, layout, n, {
+                    B_KEEP(io_buffer_find_byte(&b, 0, '\n'));
+                });
+            }
+        }
+        io_buffer_free(&b);
+    }
+
+    B_StaticBuffer sb;
+    memset(sb.buf, 'y', sizeof(sb.buf));
+    for (int w = 0; w < 2; w++) {
+        bool wrapped = w == 1;
+        const char *layout = wrapped ? "wrapped" : "contiguous";
+        for (size_t i = 0; i < B_LEN(B_SIZES) && B_SIZES[i] <= B_STATIC_CAP; i++) {
+            size_t n = B_SIZES[i];
+            B_MEASURE("static", "append", B_STATIC_CAP, layout, n, {
+                sb.head = sb.tail = wrapped ? B_STATIC_CAP - (n + 1) / 2 : 0;
+                B_StaticBuffer_append(&sb, src, n);
+                B_KEEP(sb.tail);
+            });
+            B_MEASURE("static", "nspit", B_STATIC_CAP, layout, n, {
+                b_static_layout(&sb, n, wrapped);
+                B_StaticBuffer_nspit(&sb, dest, n);
+                B_KEEP(dest);
+            });
+            b_static_layout(&sb, n, wrapped);
+            B_MEASURE("static", "at_scan", B_STATIC_CAP, layout, n, {
+                unsigned sum = 0;
+                for (size_t j = 0; j < n; j++) sum += (unsigned char)B_StaticBuffer_at(&sb, j);
+                B_KEEP(sum);
+            });
+        }
+    }
+
+    free(src);
+    free(dest);
+    return 0;
+}
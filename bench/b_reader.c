@@ -0,0 +1,249 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#define IO_IMPL
+#include "../io.h"
+#include "_bench.c"
+
+#define B_CAP       (64 << 10)
+#define B_TOTAL_MAX (64 << 20)
+#define B_CHUNK     (64 << 10)
+
+static const size_t B_SIZES[] = {1, 64, 4 << 10, 64 << 10, 1 << 20};
+
+#define B_LEN(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+typedef enum {
+    B_OP_NREAD,
+    B_OP_NREAD_RA,
+    B_OP_NPEEK,
+    B_OP_NREAD_FULL,
+} B_Op;
+
+static const char *B_OP_NAMES[] = {"nread", "nread_ra", "npeek", "nread_full"};
+
+static char b_chunk[B_CHUNK];
+
+/**
+ * Infinite in-memory stream: isolates the cost of the reader from the cost of
+ * syscalls.
+ */
+ssize_t b_mem_read(void *ctx, char *buf, size_t n) {
+    (void)ctx;
+    n = MIN(n, (size_t)B_CHUNK);
+    memcpy(buf, b_chunk, n);
+    return n;
+}
+
+typedef struct {
+    int fd;
+    size_t total;
+} B_Producer;
+
+void *b_producer(void *arg) {
+    B_Producer *p = arg;
+    size_t sent = 0;
+    while (sent < p->total) {
+        ssize_t n = write(p->fd, b_chunk, MIN((size_t)B_CHUNK, p->total - sent));
+        if (n <= 0) B_FATAL("Failed to write: %s", strerror(errno));
+        sent += n;
+    }
+    close(p->fd);
+    return NULL;
+}
+
+/**
+ * Reads `total` bytes using reader `r` in requests of `n` bytes with `op`.
+ */
+static void b_consume(IO_Reader *r, B_Op op, size_t n, size_t total, char *dest) {
+    size_t start = r->pos;
+    while (r->pos - start < total) {
+        size_t want = MIN(n, total - (r->pos - start));
+        IO_Err err = IO_ERR_OK;
+        switch (op) {
+        case B_OP_NREAD:
+        case B_OP_NREAD_RA:
+            err = io_reader_nread(r, dest, want);
+            break;
+        case B_OP_NPEEK:
+            err = io_reader_npeek(r, dest, want);
+            if (err == IO_ERR_OK || err == IO_ERR_PARTIAL) {
+                io_reader_nconsume(r, NULL, MIN(want, io_reader_buffered(r)));
+            }
+            break;
+        case B_OP_NREAD_FULL:
+            err = io_reader_nread_full(r, dest, want);
+            break;
+        }
+        if (err != IO_ERR_OK && err != IO_ERR_PARTIAL) B_FATAL("Failed to read: %s", io_err_to_cstr(err));
+        B_KEEP(dest);
+    }
+}
+
+static bool b_op_supported(B_Op op, size_t n) {
+    // NOTE: Only io_reader_nread_full() handles requests larger than the
+    //       buffer capacity without a short read for every call.
+    if (n >= B_CAP) return op == B_OP_NREAD_FULL;
+    return true;
+}
+
+static void b_reader_setup(IO_Reader *r, B_Op op) {
+    if (op != B_OP_NREAD_RA) return;
+    if (io_reader_set_readahead(r, 4 << 10, B_CAP) != IO_ERR_OK) B_FATAL("Failed to enable read-ahead");
+}
+
+/**
+ * Total amount of bytes transferred for `n` byte requests: scaled down for
+ * small requests so that every case finishes in a reasonable time.
+ */
+static size_t b_total(size_t n) {
+    return MIN((size_t)B_TOTAL_MAX, n << 18);
+}
+
+static void b_run_mem(B_Op op, size_t n, char *dest) {
+    IO_Buffer b;
+    IO_Reader r;
+    IO_Source src = {.read = b_mem_read};
+    if (io_buffer_init(&b, B_CAP) != IO_ERR_OK) B_FATAL("Failed to initialize buffer");
+    io_reader_init_source(&r, &b, &src);
+    b_reader_setup(&r, op);
+
+    B_MEASURE("reader", B_OP_NAMES[op], B_CAP, "mem", n, {
+        b_consume(&r, op, n, n, dest);
+    });
+    io_buffer_free(&b);
+}
+
+static void b_run_stream(B_Op op, size_t n, const char *layout, char *dest) {
+    int fds[2];
+    if (strcmp(layout, "pipe") == 0) {
+        if (pipe(fds) < 0) B_FATAL("Failed to create pipe: %s", strerror(errno));
+    } else {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) B_FATAL("Failed to create socketpair: %s", strerror(errno));
+    }
+
+    size_t total = b_total(n);
+    B_Producer p = {.fd = fds[1], .total = total};
+    IO_Buffer b;
+    IO_Reader r;
+    if (io_buffer_init(&b, B_CAP) != IO_ERR_OK) B_FATAL("Failed to initialize buffer");
+    io_reader_init(&r, &b, fds[0]);
+    b_reader_setup(&r, op);
+
+    uint64_t start = b_now_ns();
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, b_producer, &p) != 0) B_FATAL("Failed to start producer");
+    b_consume(&r, op, n, total, dest);
+    uint64_t ns = b_now_ns() - start;
+    pthread_join(thread, NULL);
+    b_report("reader", B_OP_NAMES[op], B_CAP, layout, n, total / n, ns);
+
+    io_buffer_free(&b);
+    close(fds[0]);
+}
+
+static void b_run_file(B_Op op, size_t n, int fd, bool mapped, char *dest) {
+    size_t total = b_total(n);
+    IO_Buffer b = {0};
+    IO_Reader r;
+    lseek(fd, 0, SEEK_SET);
+
+    uint64_t start = b_now_ns();
+    if (mapped) {
+        if (io_reader_init_mmap(&r, &b, fd) != IO_ERR_OK) B_FATAL("Failed to map file");
+    } else {
+        if (io_buffer_init(&b, B_CAP) != IO_ERR_OK) B_FATAL("Failed to initialize buffer");
+        io_reader_init(&r, &b, fd);
+        b_reader_setup(&r, op);
+    }
+    b_consume(&r, op, n, total, dest);
+    uint64_t ns = b_now_ns() - start;
+    b_report("reader", B_OP_NAMES[op], mapped ? b.cap : B_CAP, mapped ? "mmap" : "file", n, total / n, ns);
+
+    io_buffer_free(&b);
+}
+
+static char b_lines[B_CHUNK];
+
+/**
+ * Infinite in-memory stream of `*ctx`-byte lines (including the LF).
+ */
+ssize_t b_lines_read(void *ctx, char *buf, size_t n) {
+    size_t len = *(size_t *)ctx;
+    n = MIN(n, (size_t)B_CHUNK - B_CHUNK % len);
+    memcpy(buf, b_lines, n);
+    return n;
+}
+
+/**
+ * Reads `n`-byte lines one by one with io_reader_readline() and in batches
+ * with io_reader_read_records(). An operation is one line.
+ */
+static void b_run_records(size_t n) {
+    IO_Buffer b;
+    IO_Reader r;
+    IO_Source src = {.read = b_lines_read, .ctx = &n};
+    IO_Span recs[256];
+    char scratch[B_CAP];
+    for (size_t i = 0; i < B_CHUNK; i++) b_lines[i] = (i % n == n - 1) ? '\n' : 'x';
+
+    if (io_buffer_init(&b, B_CAP) != IO_ERR_OK) B_FATAL("Failed to initialize buffer");
+    io_reader_init_source(&r, &b, &src);
+    B_MEASURE("reader", "readline", B_CAP, "mem", n, {
+        if (io_reader_readline(&r, &recs[0], scratch, sizeof(scratch)) != IO_ERR_OK) B_FATAL("Failed to read line");
+        B_KEEP(recs[0].ptr);
+    });
+    io_buffer_free(&b);
+
+    if (io_buffer_init(&b, B_CAP) != IO_ERR_OK) B_FATAL("Failed to initialize buffer");
+    io_reader_init_source(&r, &b, &src);
+    size_t nrecs = 0, taken = 0;
+    B_MEASURE("reader", "read_records", B_CAP, "mem", n, {
+        if (taken == nrecs) {
+            nrecs = sizeof(recs) / sizeof(recs[0]);
+            if (io_reader_read_records(&r, "\n", 1, recs, &nrecs, scratch, sizeof(scratch)) != IO_ERR_OK) B_FATAL("Failed to read records");
+            taken = 0;
+        }
+        B_KEEP(recs[taken++].ptr);
+    });
+    io_buffer_free(&b);
+}
+
+int main(void) {
+    char *dest = malloc(1 << 20);
+    if (dest == NULL) B_FATAL("Failed to allocate memory");
+    memset(b_chunk, 'x', sizeof(b_chunk));
+
+    char path[] = "/tmp/io_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) B_FATAL("Failed to create file: %s", strerror(errno));
+    unlink(path);
+    for (size_t written = 0; written < B_TOTAL_MAX; written += B_CHUNK) {
+        if (write(fd, b_chunk, B_CHUNK) != B_CHUNK) B_FATAL("Failed to write file: %s", strerror(errno));
+    }
+
+    b_header();
+    for (size_t i = 0; i < B_LEN(B_SIZES); i++) {
+        size_t n = B_SIZES[i];
+        for (B_Op op = B_OP_NREAD; op <= B_OP_NREAD_FULL; op++) {
+            if (!b_op_supported(op, n)) continue;
+            b_run_mem(op, n, dest);
+            b_run_stream(op, n, "pipe", dest);
+            b_run_stream(op, n, "socketpair", dest);
+            b_run_file(op, n, fd, false, dest);
+            if (op == B_OP_NREAD) b_run_file(op, n, fd, true, dest);
+        }
+    }
+
+    b_run_records(16);
+    b_run_records(64);
+    b_run_records(256);
+
+    close(fd);
+    free(dest);
+    return 0;
+}
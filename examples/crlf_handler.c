@@ -73,32 +73,28 @@ size_t read_msg(IO_Reader *r, char *msg, size_t maxlen) {
     }
     assert((err == IO_ERR_OK || err == IO_ERR_PARTIAL) && "Failed to read message");
 
-    // Iterate over msg until met CR or LF
-    size_t n = 0;
+    // Search buffered data for the first CR or LF
     size_t buffered = io_reader_buffered(r);
-    while (n < maxlen && n < buffered) {
-        char c = io_buffer_at(r->b, n++);
-        if (c == '\r' || c == '\n') {
-            // When met CR or LF consume n elements
-            assert(io_reader_nconsume(r, msg, n) == IO_ERR_OK && "Failed to consume reader");
-            // If it's \r peek for 1 byte to check if it's \n
-            if (c == '\r') {
-                err = io_reader_npeek(r, &c, 1);
-                // If EOF: noop
-                if (err == IO_ERR_EOF) {
-                    printf("Reached EOF\n");
-                    break;
-                }
-                assert((err == IO_ERR_OK || err == IO_ERR_PARTIAL) && "Failed to read message");
-            }
-            // If the peeked byte is \n: consume 1 byte.
-            if (c == '\n') {
-                char *dest = (n > maxlen) ? NULL : msg + n;
-                assert(io_reader_nconsume(r, dest, 1) == IO_ERR_OK && "Failed to consume reader");
-                n++;
-            }
-            break;
-        }
+    size_t n = io_buffer_find_any(r->b, 0, "\r\n", 2);
+    if (n == IO_NOT_FOUND || n >= maxlen) return MIN(buffered, maxlen);
+
+    // When met CR or LF consume n elements
+    char c = io_buffer_at(r->b, n++);
+    assert(io_reader_nconsume(r, msg, n) == IO_ERR_OK && "Failed to consume reader");
+    if (c == '\n') return n;
+
+    // If it's \r peek for 1 byte to check if it's \n
+    err = io_reader_npeek(r, &c, 1);
+    // If EOF: noop
+    if (err == IO_ERR_EOF) {
+        printf("Reached EOF\n");
+        return n;
+    }
+    assert((err == IO_ERR_OK || err == IO_ERR_PARTIAL) && "Failed to read message");
+    // If the peeked byte is \n: consume 1 byte.
+    if (c == '\n' && n < maxlen) {
+        assert(io_reader_nconsume(r, msg + n, 1) == IO_ERR_OK && "Failed to consume reader");
+        n++;
     }
     return n;
 }
@@ -0,0 +1,126 @@
+/**
+ * This example creates a TCP listener on address 0.0.0.0:8080 and serves any
+ * number of connections at once from a single thread using `IO_Loop`. Every
+ * line received on a connection is sent back to it. A connection that stays
+ * silent for 10 seconds is closed.
+ *
+ * Try it with several `nc localhost 8080` sessions at once.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#define IO_LOOP
+#define IO_IMPL
+#include "../io.h"
+
+#define LINE_MAX_LEN 1 << 10
+#define IDLE_TIMEOUT_MS 10000
+
+typedef struct {
+    IO_Conn c;
+    IO_Reader r;
+    IO_Writer w;
+    IO_Buffer rb, wb;
+    IO_Timer idle;
+} Client;
+
+int newlistener() {
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(sockfd >= 0 && "Failed to create socket");
+
+    int _true = 1;
+    assert(setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &_true, sizeof(_true)) != -1 && "Failed to set socket option");
+
+    struct sockaddr_in saddr = {0};
+    saddr.sin_family=AF_INET;
+    saddr.sin_port=htons(8080);
+    saddr.sin_addr.s_addr=INADDR_ANY;
+    assert(bind(sockfd, (struct sockaddr *) &saddr, sizeof(saddr)) == 0 && "Failed to bind address");
+    assert(listen(sockfd, 128) != -1 && "Failed to start listening on address");
+
+    fcntl(sockfd, F_SETFL, O_NONBLOCK);
+    return sockfd;
+}
+
+void client_free(IO_Loop *l, Client *cl) {
+    io_loop_cancel_timer(l, &cl->idle);
+    io_loop_remove(l, &cl->c);
+    close(cl->r.fd);
+    io_buffer_free(&cl->rb);
+    io_buffer_free(&cl->wb);
+    free(cl);
+}
+
+size_t on_data(IO_Loop *l, IO_Conn *c, const IO_Span *spans, size_t nspans) {
+    (void)spans;
+    (void)nspans;
+    Client *cl = c->ctx;
+    io_loop_add_timer(l, &cl->idle, IDLE_TIMEOUT_MS);
+
+    IO_Span line;
+    char scratch[LINE_MAX_LEN];
+    IO_Err err;
+    while ((err = io_reader_readline(c->r, &line, scratch, sizeof(scratch))) == IO_ERR_OK) {
+        io_writer_write(c->w, line.ptr, line.len);
+        io_writer_write(c->w, "\n", 1);
+    }
+    if (err == IO_ERR_OOB) {
+        printf("<Line too long, closing connection %d>\n", cl->r.fd);
+        client_free(l, cl);
+    }
+    // NOTE: Everything was consumed by io_reader_readline(); incomplete lines
+    //       stay buffered (IO_ERR_AGAIN) until the rest arrives.
+    return 0;
+}
+
+void on_close(IO_Loop *l, IO_Conn *c, IO_Err err) {
+    Client *cl = c->ctx;
+    printf("<Connection %d closed: %s>\n", cl->r.fd, io_err_to_cstr(err));
+    client_free(l, cl);
+}
+
+void on_idle(IO_Loop *l, IO_Timer *t) {
+    Client *cl = t->ctx;
+    printf("<Connection %d idle, closing>\n", cl->r.fd);
+    client_free(l, cl);
+}
+
+size_t on_accept(IO_Loop *l, IO_Conn *c, const IO_Span *spans, size_t nspans) {
+    (void)spans;
+    (void)nspans;
+    int connfd;
+    while ((connfd = accept(c->fd, NULL, NULL)) >= 0) {
+        fcntl(connfd, F_SETFL, O_NONBLOCK);
+        Client *cl = calloc(1, sizeof(Client));
+        assert(cl != NULL && "Failed to allocate client");
+        assert(io_buffer_init(&cl->rb, LINE_MAX_LEN) == IO_ERR_OK && "Failed to initialize buffer");
+        assert(io_buffer_init(&cl->wb, LINE_MAX_LEN) == IO_ERR_OK && "Failed to initialize buffer");
+        io_reader_init(&cl->r, &cl->rb, connfd);
+        io_writer_init(&cl->w, &cl->wb, connfd);
+        cl->c = (IO_Conn){.r = &cl->r, .w = &cl->w, .on_data = on_data, .on_close = on_close, .ctx = cl};
+        cl->idle = (IO_Timer){.cb = on_idle, .ctx = cl};
+        assert(io_loop_add(l, &cl->c) == IO_ERR_OK && "Failed to watch connection");
+        io_loop_add_timer(l, &cl->idle, IDLE_TIMEOUT_MS);
+        printf("<Received connection %d>\n", connfd);
+    }
+    return 0;
+}
+
+int main(void) {
+    IO_Loop l;
+    assert(io_loop_init(&l) == IO_ERR_OK && "Failed to initialize event loop");
+
+    IO_Conn listener = {.fd = newlistener(), .on_data = on_accept};
+    assert(io_loop_add(&l, &listener) == IO_ERR_OK && "Failed to watch listener");
+
+    IO_Err err = io_loop_run(&l);
+    printf("Event loop stopped: %s\n", io_err_to_cstr(err));
+
+    close(listener.fd);
+    io_loop_free(&l);
+    return 0;
+}
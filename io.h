@@ -25,13 +25,21 @@
 #ifndef IO_H
 #  define IO_H
 
-#define IO_ERR_MAP(XX)                                          \
-    XX(1, OK,          "OK"                                 )   \
-    XX(2, OOM,         "Out of memory"                      )   \
-    XX(3, OOB,         "Out of bounds"                      )   \
-    XX(4, EOF,         "End of file"                        )   \
-    XX(5, PARTIAL,     "Reader read less than was requested")   \
-    XX(6, FAILED_READ, "Failed to read from file descriptor")
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define IO_ERR_MAP(XX)                                           \
+    XX(1, OK,           "OK"                                 )   \
+    XX(2, OOM,          "Out of memory"                      )   \
+    XX(3, OOB,          "Out of bounds"                      )   \
+    XX(4, EOF,          "End of file"                        )   \
+    XX(5, PARTIAL,      "Reader read less than was requested")   \
+    XX(6, FAILED_READ,  "Failed to read from file descriptor")   \
+    XX(7, UNSUPPORTED,  "Operation is not supported"         )   \
+    XX(8, AGAIN,        "Operation would block"              )   \
+    XX(9, FAILED_WRITE, "Failed to write to file descriptor" )
 
 
 typedef enum {
@@ -47,6 +55,23 @@ typedef enum {
  */
 const char *io_err_to_cstr(IO_Err err);
 
+/**
+ * Instrumentation counters of an IO buffer, only maintained when `IO_STATS`
+ * is defined (see io_reader_stats()):
+ *
+ * - `ncopied`: bytes copied by io_buffer_nspit() and io_buffer_append(),
+ * - `nwraps`: times the end of the data wrapped back to the start of the
+ *   storage,
+ * - `peak`: the largest number of bytes buffered at once.
+ *
+ * NOTE: `IO_STATS` changes the layout of `IO_Buffer` and `IO_Reader`, so it
+ *       must be defined the same way in every translation unit.
+ */
+typedef struct {
+    uint64_t ncopied, nwraps;
+    size_t peak;
+} IO_BufferStats;
+
 /**
  * Reusable circular buffer for IO operations.
  *
@@ -65,12 +90,75 @@ const char *io_err_to_cstr(IO_Err err);
  * in this range of memory: [start, end).
  *
  * NOTE: Case, when `start == end`, implies an empty buffer.
+ *
+ * `flags` describe how the storage was allocated (see `IO_BufferFlags`).
+ * Zero means a plain heap allocation done by io_buffer_init().
+ *
+ * `min_cap` and `max_cap` bound the capacity of growable buffers (see
+ * io_buffer_init_growable()); both equal `cap` otherwise. `pool` is the pool
+ * the storage of a pooled buffer comes from (see io_buffer_init_pooled()).
  */
 typedef struct {
     char *buf, *start, *end;
-    size_t cap;
+    size_t cap, min_cap, max_cap;
+    int flags;
+    struct IO_BufferPool *pool;
+#ifdef IO_STATS
+    IO_BufferStats stats;
+#endif // IO_STATS
 } IO_Buffer;
 
+typedef enum {
+    /**
+     * The storage is mapped twice back to back in virtual memory: the byte at
+     * `buf + i` is also visible at `buf + cap + 1 + i`. Thus both the data
+     * region and the free region are always contiguous when accessed from
+     * `start` and `end` respectively. See io_buffer_init_mirrored().
+     */
+    IO_BUFFER_MIRRORED = 1 << 0,
+    /**
+     * The storage is a read-only memory mapping of a file, set up by
+     * io_reader_init_mmap(). The data region never wraps and there is no free
+     * space to write into.
+     */
+    IO_BUFFER_MAPPED   = 1 << 1,
+    /**
+     * The storage is a heap allocation that is reallocated as needed between
+     * `min_cap` and `max_cap`. See io_buffer_init_growable().
+     */
+    IO_BUFFER_GROWABLE = 1 << 2,
+    /**
+     * The storage is a block of an `IO_BufferPool`. See
+     * io_buffer_init_pooled().
+     */
+    IO_BUFFER_POOLED   = 1 << 3,
+    /**
+     * The storage is an anonymous memory mapping set up by
+     * io_buffer_init_opts() and unmapped by io_buffer_free().
+     */
+    IO_BUFFER_PAGES    = 1 << 4,
+} IO_BufferFlags;
+
+/**
+ * Pool of fixed-size buffer storage blocks.
+ *
+ * Blocks of `block_size` bytes (enough for a buffer of `cap` capacity,
+ * rounded up to a multiple of `IO_BUFFER_POOL_ALIGN`) are carved out of
+ * page-aligned slabs of `nblocks` blocks each, that are mapped as needed and
+ * only unmapped by io_buffer_pool_free(). Released blocks are kept in an
+ * intrusive free list and handed out again first (most recently used first,
+ * so they are likely still in cache).
+ *
+ * NOTE: The pool is not thread-safe. Use a separate pool per thread (e.g.
+ *       one per event loop), which also keeps the free list thread-local.
+ */
+typedef struct IO_BufferPool {
+    size_t cap, block_size, nblocks;
+    char *slabs;
+    void *free_list;
+    size_t nfree;
+} IO_BufferPool;
+
 /**
  * Initializes IO buffer `b` wtih `cap` capacity.
  *
@@ -78,6 +166,145 @@ typedef struct {
  */
 IO_Err io_buffer_init(IO_Buffer *b, size_t cap);
 
+/**
+ * Initializes IO buffer `b` with at least `cap` capacity, using mirrored
+ * storage (see `IO_BUFFER_MIRRORED`).
+ *
+ * With mirrored storage, `io_buffer_len(b)` bytes starting at `b->start` can
+ * be accessed as one contiguous array, even when the data wraps around. So
+ * can the free space starting at `b->end`.
+ *
+ * The physical size (`cap + 1`) is rounded up to a multiple of the page size,
+ * so `b->cap` may end up larger than requested.
+ *
+ * Returns `IO_ERR_UNSUPPORTED` if the platform provides no way to create
+ * such a mapping. The callee must free the buffer later using
+ * `io_buffer_free()` function.
+ */
+IO_Err io_buffer_init_mirrored(IO_Buffer *b, size_t cap);
+
+/**
+ * Options of io_buffer_init_opts(). Zero-initialized options make it
+ * equivalent to io_buffer_init().
+ *
+ * - `align`: the storage address and its size (`cap + 1`) are multiples of
+ *   `align` (a power of two). Zero means the default alignment.
+ * - `flags`: a combination of `IO_BufferOptFlags`.
+ * - `numa_node`: the NUMA node to allocate the storage on, if
+ *   `IO_BUFFER_OPT_NUMA` is set.
+ */
+typedef struct {
+    size_t align;
+    int flags;
+    int numa_node;
+} IO_BufferOpts;
+
+typedef enum {
+    /**
+     * Ask for transparent huge pages (`madvise(MADV_HUGEPAGE)`). The storage is
+     * aligned to `IO_HUGE_PAGE_SIZE`; the kernel decides whether huge pages are
+     * actually used, so this never fails.
+     */
+    IO_BUFFER_OPT_HUGEPAGES = 1 << 0,
+    /**
+     * Back the storage with pages from the reserved huge page pool
+     * (`MAP_HUGETLB`). Fails with `IO_ERR_OOM` if the pool is exhausted.
+     */
+    IO_BUFFER_OPT_HUGETLB   = 1 << 1,
+    /**
+     * Bind the storage to NUMA node `numa_node` (`mbind(MPOL_BIND)`), so its
+     * pages are allocated there when first touched.
+     */
+    IO_BUFFER_OPT_NUMA      = 1 << 2,
+} IO_BufferOptFlags;
+
+/**
+ * Initializes IO buffer `b` with at least `cap` capacity, allocating the
+ * storage as described by `opts` (see `IO_BufferOpts`).
+ *
+ * Unless the options are all zero, the storage is an anonymous memory mapping
+ * (see `IO_BUFFER_PAGES`) rounded up to whole pages (huge pages with
+ * `IO_BUFFER_OPT_HUGEPAGES` or `IO_BUFFER_OPT_HUGETLB`), so `b->cap` may end
+ * up larger than requested. Meant for large, long-lived buffers.
+ *
+ * Returns `IO_ERR_OOB` if `opts->align` is not a power of two,
+ * `IO_ERR_UNSUPPORTED` if the platform does not support the requested
+ * options (huge page pool and NUMA binding are Linux only) and `IO_ERR_OOM`
+ * if the storage could not be mapped. The callee must free the buffer later
+ * using `io_buffer_free()` function.
+ */
+IO_Err io_buffer_init_opts(IO_Buffer *b, size_t cap, const IO_BufferOpts *opts);
+
+/**
+ * Initializes growable IO buffer `b` with `cap` capacity that may grow up to
+ * `max_cap` (see `IO_BUFFER_GROWABLE`).
+ *
+ * Whenever an append or a read needs more space than is free, the capacity
+ * is doubled (at most up to `max_cap`) with `IO_REALLOC`, and the data that
+ * wrapped around is moved so the buffer stays consistent. The `io_reader_*`
+ * functions grow the buffer the same way instead of returning `IO_ERR_OOB`,
+ * so longer records still fit, while idle buffers stay at their initial size:
+ * call io_buffer_shrink() to give the memory back once the buffer is drained.
+ *
+ * NOTE: Growing moves the storage, so spans and records pointing into the
+ *       buffer are invalidated by any call that may read or append.
+ *
+ * Returns `IO_ERR_OOB` if `cap > max_cap`. The callee must free the buffer
+ * later using `io_buffer_free()` function.
+ */
+IO_Err io_buffer_init_growable(IO_Buffer *b, size_t cap, size_t max_cap);
+
+/**
+ * Makes sure IO buffer `b` has room for `n` more bytes, growing it if it is
+ * growable.
+ *
+ * Returns `IO_ERR_OOB` if `n` bytes do not fit even at the maximum capacity
+ * and `IO_ERR_OOM` if the buffer could not be reallocated.
+ */
+IO_Err io_buffer_reserve(IO_Buffer *b, size_t n);
+
+/**
+ * Shrinks growable IO buffer `b` back to its initial capacity (`min_cap`) if
+ * it is empty. Does nothing for other buffers.
+ */
+IO_Err io_buffer_shrink(IO_Buffer *b);
+
+/**
+ * Initializes buffer pool `p` handing out storage for buffers of `cap`
+ * capacity, mapping `nblocks` blocks at a time.
+ *
+ * The caller must free the pool later using io_buffer_pool_free(), after all
+ * of its buffers are freed.
+ */
+IO_Err io_buffer_pool_init(IO_BufferPool *p, size_t cap, size_t nblocks);
+
+/**
+ * Frees buffer pool `p`, unmapping all its slabs.
+ */
+IO_Err io_buffer_pool_free(IO_BufferPool *p);
+
+/**
+ * Initializes IO buffer `b` with the capacity of pool `p`, taking its storage
+ * from the pool (see `IO_BUFFER_POOLED`). io_buffer_free() gives the storage
+ * back to the pool.
+ *
+ * Returns `IO_ERR_OOM` if the pool has no free block and a new slab could not
+ * be mapped.
+ */
+IO_Err io_buffer_init_pooled(IO_Buffer *b, IO_BufferPool *p);
+
+/**
+ * Gives the storage of pooled IO buffer `b` back to its pool if the buffer is
+ * empty, so idle connections hold no buffer memory. Does nothing for other
+ * buffers.
+ *
+ * A detached buffer behaves as an empty buffer of the same capacity. It takes
+ * a block from the pool again as soon as something needs to write into it
+ * (io_buffer_append(), io_buffer_reserve() and the `io_reader_*` reads), so
+ * readers and writers need no special handling.
+ */
+IO_Err io_buffer_detach(IO_Buffer *b);
+
 /**
  * Frees IO buffer `b`.
  */
@@ -134,17 +361,460 @@ IO_Err io_buffer_nspit(IO_Buffer *src, char *dest, size_t n);
  */
 IO_Err io_buffer_append(IO_Buffer *dest, char *src, size_t n);
 
+/**
+ * Contiguous region of memory: `len` bytes starting at `ptr`.
+ */
+typedef struct {
+    char *ptr;
+    size_t len;
+} IO_Span;
+
+/**
+ * Fills `spans` with up to two contiguous regions that together make up the
+ * data of IO buffer `b` in logical order, and returns the number of regions
+ * filled (0 if the buffer is empty, 2 if the data wraps around).
+ *
+ * The spans point directly into the buffer's storage, so no data is copied.
+ * They stay valid until the buffer is modified.
+ */
+size_t io_buffer_peek_spans(IO_Buffer *b, IO_Span spans[2]);
+
+/**
+ * Fills `spans` with up to two contiguous free regions of IO buffer `b`
+ * (starting at `b->end`) and returns the number of regions filled (0 if the
+ * buffer is full).
+ *
+ * The caller may write into the regions directly and then make the written
+ * bytes part of the buffer's data with io_buffer_commit(). If the buffer is
+ * empty, it is rewound first so that the whole capacity is available as one
+ * region.
+ */
+size_t io_buffer_reserve_spans(IO_Buffer *b, IO_Span spans[2]);
+
+/**
+ * Appends `n` bytes, that were written directly into the free regions
+ * returned by io_buffer_reserve_spans(), to the data of IO buffer `b`.
+ *
+ * If `n` exceeds the free space left in the buffer, returns `IO_ERR_OOB`.
+ */
+IO_Err io_buffer_commit(IO_Buffer *b, size_t n);
+
+/**
+ * Value returned by the `io_buffer_find*()` functions when nothing was found.
+ */
+#define IO_NOT_FOUND ((size_t)-1)
+
+/**
+ * Returns the logical position (as accepted by io_buffer_at()) of the first
+ * byte equal to `c` in IO buffer `b`, starting the search at logical position
+ * `from`. Returns `IO_NOT_FOUND` if there is no such byte.
+ *
+ * The search runs over each contiguous region of the buffer with `memchr`,
+ * so it is wrap-aware and does not go through io_buffer_at() byte by byte.
+ */
+size_t io_buffer_find_byte(IO_Buffer *b, size_t from, char c);
+
+/**
+ * Same as io_buffer_find_byte(), but looks for the first byte equal to any
+ * of the `nset` bytes in `set` (e.g. `"\r\n"`).
+ *
+ * Uses SSE2/AVX2 kernels when the compiler targets them and `nset` is small.
+ */
+size_t io_buffer_find_any(IO_Buffer *b, size_t from, const char *set, size_t nset);
+
+/**
+ * Returns the logical position of the first occurrence of the `n`-byte
+ * `needle` (e.g. `"\r\n\r\n"`) in IO buffer `b`, starting the search at
+ * logical position `from`. The occurrence may straddle the wrap boundary.
+ * Returns `IO_NOT_FOUND` if there is no such occurrence.
+ */
+size_t io_buffer_find(IO_Buffer *b, size_t from, const char *needle, size_t n);
+
+/**
+ * Optimization barrier for integer variable `x`: an empty `asm` statement
+ * that takes `x` in a register and claims to modify it. No instructions are
+ * emitted and the value doesn't change, but the compiler can no longer
+ * assume anything about it (e.g. an upper bound derived from a mask).
+ * Internal to `IO_BUFFER_STATIC`.
+ *
+ * NOTE: Copy lengths bounded by a constant capacity make GCC inline `memcpy`
+ *       as `rep movs`, which is several times slower than the library call
+ *       for short copies (wrapped copies of 16-256 bytes take 6-9 ns with
+ *       the barrier and 34-58 ns without in `bench/b_buffer.c`). Hiding the
+ *       offset also keeps `-Warray-bounds` from flagging copies on branches
+ *       that can't be taken.
+ * NOTE: Compilers without GNU inline assembly get a no-op: the code stays
+ *       correct, only the copies may be inlined.
+ */
+#if defined(__GNUC__)
+#  define _IO_OPAQUE(x) __asm__("" : "+r"(x))
+#else
+#  define _IO_OPAQUE(x) ((void)(x))
+#endif // defined(__GNUC__)
+
+/**
+ * Defines fixed-capacity circular buffer type `name` with `cap` bytes of
+ * inline storage, plus `static inline` functions operating on it, named
+ * after the type: name##_init(), name##_len(), name##_at(), name##_append(),
+ * name##_nspit(), name##_nadvance(), name##_peek_spans(),
+ * name##_reserve_spans() and name##_commit(). They behave the same way as
+ * their `io_buffer_*` counterparts.
+ *
+ * The buffer needs no allocation and no freeing, so it can live on the
+ * stack, inside another struct or in static storage:
+ *
+ *     IO_BUFFER_STATIC(Scratch, 4096)
+ *
+ *     Scratch s;
+ *     Scratch_init(&s);
+ *     Scratch_append(&s, "hello", 5);
+ *
+ * `cap` must be a power of two known at compile time. `head` and `tail` are
+ * free-running byte counters that are only masked with `cap - 1` when the
+ * storage is accessed, so the whole `cap` is usable (no extra byte as in
+ * `IO_Buffer`), the length is `tail - head`, and there is no modulo or
+ * wrap-around test left for the compiler to emit.
+ *
+ * NOTE: This is not an `IO_Buffer`, so it can't back an `IO_Reader` or an
+ *       `IO_Writer`.
+ */
+#define IO_BUFFER_STATIC(name, cap)                                                 \
+    _Static_assert((cap) > 0 && ((cap) & ((cap) - 1)) == 0,                         \
+                   #name ": capacity must be a power of two");                      \
+                                                                                    \
+    typedef struct {                                                                \
+        size_t head, tail;                                                          \
+        char buf[(cap)];                                                            \
+    } name;                                                                         \
+                                                                                    \
+    static inline void name##_init(name *b) {                                       \
+        b->head = b->tail = 0;                                                      \
+    }                                                                               \
+                                                                                    \
+    static inline size_t name##_len(const name *b) {                                \
+        return b->tail - b->head;                                                   \
+    }                                                                               \
+                                                                                    \
+    static inline char name##_at(const name *b, size_t pos) {                       \
+        return b->buf[(b->head + pos) & ((cap) - 1)];                               \
+    }                                                                               \
+                                                                                    \
+    static inline IO_Err name##_append(name *b, const char *src, size_t n) {        \
+        if (n > (cap) - name##_len(b)) return IO_ERR_OOB;                           \
+        size_t off = b->tail & ((cap) - 1), room = (cap) - off;                     \
+        _IO_OPAQUE(off);                                                            \
+        _IO_OPAQUE(room);                                                           \
+        if (n <= room) {                                                            \
+            memcpy(b->buf + off, src, n);                                           \
+        } else {                                                                    \
+            memcpy(b->buf + off, src, room);                                        \
+            memcpy(b->buf, src + room, n - room);                                   \
+        }                                                                           \
+        b->tail += n;                                                               \
+        return IO_ERR_OK;                                                           \
+    }                                                                               \
+                                                                                    \
+    static inline IO_Err name##_nspit(const name *b, char *dest, size_t n) {        \
+        if (n == 0 || dest == NULL) return IO_ERR_OK;                               \
+        if (n > name##_len(b)) return IO_ERR_OOB;                                   \
+        size_t off = b->head & ((cap) - 1), room = (cap) - off;                     \
+        _IO_OPAQUE(off);                                                            \
+        _IO_OPAQUE(room);                                                           \
+        if (n <= room) {                                                            \
+            memcpy(dest, b->buf + off, n);                                          \
+        } else {                                                                    \
+            memcpy(dest, b->buf + off, room);                                       \
+            memcpy(dest + room, b->buf, n - room);                                  \
+        }                                                                           \
+        return IO_ERR_OK;                                                           \
+    }                                                                               \
+                                                                                    \
+    static inline size_t name##_nadvance(name *b, size_t n) {                       \
+        size_t len = name##_len(b);                                                 \
+        size_t to_shift = (n > len) ? len : n;                                      \
+        b->head += to_shift;                                                        \
+        return to_shift;                                                            \
+    }                                                                               \
+                                                                                    \
+    static inline size_t name##_peek_spans(name *b, IO_Span spans[2]) {             \
+        size_t len = name##_len(b), off = b->head & ((cap) - 1);                    \
+        if (len == 0) return 0;                                                     \
+        if (len <= (cap) - off) {                                                   \
+            spans[0] = (IO_Span){.ptr = b->buf + off, .len = len};                  \
+            return 1;                                                               \
+        }                                                                           \
+        spans[0] = (IO_Span){.ptr = b->buf + off, .len = (cap) - off};              \
+        spans[1] = (IO_Span){.ptr = b->buf, .len = len - ((cap) - off)};            \
+        return 2;                                                                   \
+    }                                                                               \
+                                                                                    \
+    static inline size_t name##_reserve_spans(name *b, IO_Span spans[2]) {          \
+        if (b->head == b->tail) b->head = b->tail = 0;                              \
+        size_t free_len = (cap) - name##_len(b), off = b->tail & ((cap) - 1);       \
+        if (free_len == 0) return 0;                                                \
+        if (free_len <= (cap) - off) {                                              \
+            spans[0] = (IO_Span){.ptr = b->buf + off, .len = free_len};             \
+            return 1;                                                               \
+        }                                                                           \
+        spans[0] = (IO_Span){.ptr = b->buf + off, .len = (cap) - off};              \
+        spans[1] = (IO_Span){.ptr = b->buf, .len = free_len - ((cap) - off)};       \
+        return 2;                                                                   \
+    }                                                                               \
+                                                                                    \
+    static inline IO_Err name##_commit(name *b, size_t n) {                         \
+        if (n > (cap) - name##_len(b)) return IO_ERR_OOB;                           \
+        b->tail += n;                                                               \
+        return IO_ERR_OK;                                                           \
+    }
+
+#ifndef __STDC_NO_ATOMICS__
+#include <stdatomic.h>
+
+#ifndef IO_CACHE_LINE
+#  define IO_CACHE_LINE 64
+#endif // IO_CACHE_LINE
+
+/**
+ * Single-producer/single-consumer circular buffer for handing bytes over from
+ * one thread to another without locks.
+ *
+ * The storage is laid out the same way as that of `IO_Buffer` (`cap + 1`
+ * bytes, empty when both positions are equal), but the positions are atomic
+ * offsets into it: `tail` is only written by the producer (io_spsc_append(),
+ * io_spsc_publish()) and `head` only by the consumer (io_spsc_nadvance()).
+ * Each side publishes its position with a release store after it is done with
+ * the bytes, and the other side observes it with an acquire load, so the bytes
+ * themselves need no synchronization.
+ *
+ * The fields of each side live on their own cache line, together with a cached
+ * copy of the other side's position. It is only refreshed when the cached copy
+ * shows too little data (or space), so in a steady stream each side reads the
+ * other's cache line about once per batch.
+ *
+ * NOTE: Exactly one thread may call the producer functions and exactly one
+ *       thread the consumer functions at a time.
+ */
+typedef struct {
+    char *buf;
+    size_t cap;
+    _Alignas(IO_CACHE_LINE) _Atomic size_t head;
+    size_t tail_cached;
+    _Alignas(IO_CACHE_LINE) _Atomic size_t tail;
+    size_t head_cached;
+} IO_SpscBuffer;
+
+/**
+ * Initializes SPSC buffer `q` with `cap` capacity.
+ *
+ * The callee must free the buffer later using `io_spsc_free()` function.
+ */
+IO_Err io_spsc_init(IO_SpscBuffer *q, size_t cap);
+
+/**
+ * Frees SPSC buffer `q`.
+ */
+IO_Err io_spsc_free(IO_SpscBuffer *q);
+
+/**
+ * Producer: appends `n` bytes from `src` into SPSC buffer `q` and publishes
+ * them to the consumer.
+ *
+ * Same as io_buffer_append(): returns `IO_ERR_OOB` (appending nothing) if
+ * there's not enough free space for all `n` bytes.
+ */
+IO_Err io_spsc_append(IO_SpscBuffer *q, const char *src, size_t n);
+
+/**
+ * Producer: fills `spans` with up to two contiguous free regions of SPSC
+ * buffer `q` and returns the number of regions filled (0 if the buffer is
+ * full). Same as io_buffer_reserve_spans(), except that an empty buffer is
+ * not rewound.
+ *
+ * Write any number of bytes into the regions and make them visible to the
+ * consumer at once with io_spsc_publish().
+ */
+size_t io_spsc_reserve_spans(IO_SpscBuffer *q, IO_Span spans[2]);
+
+/**
+ * Producer: publishes `n` bytes written into the regions returned by
+ * io_spsc_reserve_spans() to the consumer. Returns `IO_ERR_OOB` if `n`
+ * exceeds the free space.
+ */
+IO_Err io_spsc_publish(IO_SpscBuffer *q, size_t n);
+
+/**
+ * Consumer: returns the number of bytes of SPSC buffer `q` available to the
+ * consumer.
+ */
+size_t io_spsc_len(IO_SpscBuffer *q);
+
+/**
+ * Consumer: fills `spans` with up to two contiguous regions that make up the
+ * data of SPSC buffer `q` published so far, same as io_buffer_peek_spans().
+ *
+ * Process any number of bytes in place and give them back to the producer
+ * at once with io_spsc_nadvance().
+ */
+size_t io_spsc_peek_spans(IO_SpscBuffer *q, IO_Span spans[2]);
+
+/**
+ * Consumer: copies `n` bytes of data from SPSC buffer `q` into `dest` without
+ * consuming them. Same as io_buffer_nspit().
+ */
+IO_Err io_spsc_nspit(IO_SpscBuffer *q, char *dest, size_t n);
+
+/**
+ * Consumer: consumes up to `n` bytes of SPSC buffer `q`, making their space
+ * available to the producer again, and returns the number of bytes consumed.
+ * Same as io_buffer_nadvance().
+ */
+size_t io_spsc_nadvance(IO_SpscBuffer *q, size_t n);
+
+/**
+ * Number of sub-buckets per power of two of an `IO_Histogram`, as a power of
+ * two. Recorded values are exact below `1 << IO_HISTOGRAM_SUB_BITS` and
+ * within `1 / (1 << IO_HISTOGRAM_SUB_BITS)` of the actual value above.
+ */
+#ifndef IO_HISTOGRAM_SUB_BITS
+#  define IO_HISTOGRAM_SUB_BITS 4
+#endif // IO_HISTOGRAM_SUB_BITS
+
+#define IO_HISTOGRAM_BUCKETS ((64 - IO_HISTOGRAM_SUB_BITS + 1) << IO_HISTOGRAM_SUB_BITS)
+
+/**
+ * Log-linear (HDR-style) histogram of 64-bit values, e.g. latencies in
+ * nanoseconds or TSC ticks.
+ *
+ * Values are counted in buckets that split every power of two into
+ * `1 << IO_HISTOGRAM_SUB_BITS` equal parts, so the relative error is bounded
+ * over the whole 64-bit range with a fixed amount of memory. Recording is a
+ * couple of relaxed atomic increments: any number of threads may record into
+ * the same histogram and read percentiles from it at the same time without
+ * locks. A zero-initialized histogram is empty.
+ */
+typedef struct {
+    _Atomic uint64_t count, sum, max;
+    _Atomic uint64_t buckets[IO_HISTOGRAM_BUCKETS];
+} IO_Histogram;
+
+/**
+ * Empties histogram `h`.
+ *
+ * NOTE: Values recorded concurrently with the reset may be partially lost.
+ */
+IO_Err io_histogram_reset(IO_Histogram *h);
+
+/**
+ * Records value `v` into histogram `h`.
+ */
+void io_histogram_record(IO_Histogram *h, uint64_t v);
+
+/**
+ * Returns the value below or at which `p` percent (0 to 100) of the values
+ * recorded into histogram `h` lie, as the highest value of its bucket (but
+ * never above the maximum recorded value). Returns 0 for an empty histogram.
+ */
+uint64_t io_histogram_percentile(IO_Histogram *h, double p);
+
+/**
+ * Writes a one-line summary of histogram `h` into file descriptor `fd`:
+ *
+ *     <name> count=<n> mean=<v> p50=<v> p99=<v> p999=<v> max=<v>
+ *
+ * Returns `IO_ERR_FAILED_WRITE` if the line could not be written.
+ */
+IO_Err io_histogram_dump(IO_Histogram *h, const char *name, int fd);
+#endif // __STDC_NO_ATOMICS__
+
+/**
+ * Custom data source for a reader (e.g. a TLS session, an in-memory stream or
+ * a decompressor), used instead of reading from a file descriptor.
+ *
+ * `read` reads up to `n` bytes into `buf`; `readv` (optional, may be NULL)
+ * reads into `cnt` regions described by `spans`, filling them in order. Both
+ * follow the conventions of `read(2)`: they return the number of bytes read,
+ * 0 on end of stream, or -1 with `errno` set on failure (`EAGAIN` when no data
+ * is available right now, which is reported as `IO_ERR_AGAIN`). `ctx` is
+ * passed to both callbacks as is.
+ */
+typedef struct {
+    ssize_t (*read)(void *ctx, char *buf, size_t n);
+    ssize_t (*readv)(void *ctx, const IO_Span *spans, int cnt);
+    void *ctx;
+} IO_Source;
+
+/**
+ * Instrumentation counters of a reader, only maintained when `IO_STATS` is
+ * defined (see io_reader_stats()):
+ *
+ * - `nreads`: read system calls (or `IO_Source` callbacks) made,
+ * - `nbytes`: bytes they returned,
+ * - `nshort`: reads that returned data, but less than was asked for (not
+ *   tracked for `IO_Async` reads),
+ * - `neof`, `nagain`: reads that reported end of file and `EAGAIN`,
+ * - `b`: the counters of the reader's buffer (see `IO_BufferStats`).
+ *
+ * Many short reads per byte mean the reader is syscall-bound (enable or
+ * raise read-ahead); a high `b.ncopied` relative to `nbytes` means it is
+ * copy-bound (consider the span API).
+ */
+typedef struct {
+    uint64_t nreads, nbytes, nshort, neof, nagain;
+    IO_BufferStats b;
+} IO_ReaderStats;
+
+/**
+ * Hot-path events of a reader that can be traced (see `IO_TRACE_BEGIN`):
+ *
+ * - `IO_TRACE_READ`: a single read from the file descriptor or `IO_Source`,
+ * - `IO_TRACE_COPY`: a copy between the internal buffer and the caller's
+ *   memory.
+ */
+typedef enum {
+    IO_TRACE_READ,
+    IO_TRACE_COPY,
+    IO_TRACE_COUNT,
+} IO_TraceEvent;
+
+#if defined(IO_TRACE) && defined(__STDC_NO_ATOMICS__)
+#  error "IO_TRACE requires C11 atomics"
+#endif // IO_TRACE && __STDC_NO_ATOMICS__
+
 /**
  * Reader entity.
  *
  * Represents a file descriptor reader with an associated IO_Buffer. Use this
  * to perform buffered read operations without manually managing partial reads
  * or file descriptor offsets.
+ *
+ * The file descriptor may be non-blocking (`O_NONBLOCK`). Reads interrupted by
+ * a signal (`EINTR`) are retried. If the file descriptor has no data right
+ * now (`EAGAIN`/`EWOULDBLOCK`), the `io_reader_*` functions return
+ * `IO_ERR_AGAIN` and leave the reader in a consistent state: everything read
+ * so far is kept in the buffer (or delivered to the caller, in which case
+ * `IO_ERR_PARTIAL` is returned instead), so the call may simply be repeated
+ * once the file descriptor becomes readable. This makes the reader suitable
+ * for edge-triggered event loops, which should keep calling the reader until
+ * `IO_ERR_AGAIN`.
+ *
+ * If `src.read` is set, the reader pulls data from that source instead of
+ * `fd` (see `IO_Source`).
+ *
+ * Read-ahead is off by default: every read asks the file descriptor for
+ * exactly the number of bytes the caller needs. See io_reader_set_readahead().
  */
 typedef struct {
     IO_Buffer *b;
     size_t nread, pos;
     int fd;
+    IO_Source src;
+    size_t ra_min, ra_max, ra_cur;
+#ifdef IO_STATS
+    IO_ReaderStats stats;
+#endif // IO_STATS
+#ifdef IO_TRACE
+    IO_Histogram *trace[IO_TRACE_COUNT];
+#endif // IO_TRACE
 } IO_Reader;
 
 /**
@@ -152,6 +822,74 @@ typedef struct {
  */
 IO_Err io_reader_init(IO_Reader *r, IO_Buffer *b, int fd);
 
+/**
+ * Initializes reader `r` with IO Buffer `b` reading from custom source `src`
+ * (copied into the reader) instead of a file descriptor.
+ */
+IO_Err io_reader_init_source(IO_Reader *r, IO_Buffer *b, const IO_Source *src);
+
+/**
+ * Initializes reader `r` that serves the regular file `fd` directly from a
+ * read-only memory mapping, starting at the file's current offset.
+ *
+ * IO buffer `b` must not be initialized: the function sets it up over the
+ * mapping (see `IO_BUFFER_MAPPED`), so the whole rest of the file is
+ * buffered right away and no data is ever copied from the kernel. The
+ * peek window (`b->cap`) is the file size. All `io_reader_*` and
+ * `io_buffer_*` read-side functions, including the span API, work as usual;
+ * reaching the end of the mapping is reported as `IO_ERR_EOF`.
+ *
+ * Returns `IO_ERR_UNSUPPORTED` if `fd` is not a regular file. The callee must
+ * free the buffer later using `io_buffer_free()` function.
+ */
+IO_Err io_reader_init_mmap(IO_Reader *r, IO_Buffer *b, int fd);
+
+/**
+ * Enables adaptive read-ahead for reader (`r`): from now on each read from
+ * the file descriptor asks for at least the current read-ahead size (bounded
+ * by the free space of the buffer), even when the caller needs fewer bytes,
+ * so that small peeks and reads of a chatty stream are served from the buffer.
+ *
+ * The read-ahead size starts at `min` and adapts within [`min`, `max`]: it
+ * doubles whenever a read fills the whole request (more data is likely
+ * waiting) and halves when a read returns less than a quarter of it or the
+ * file descriptor would block. Passing `max == 0` disables read-ahead.
+ *
+ * Returns `IO_ERR_OOB` if `min > max`.
+ */
+IO_Err io_reader_set_readahead(IO_Reader *r, size_t min, size_t max);
+
+/**
+ * Copies a snapshot of the instrumentation counters of reader (`r`) and its
+ * buffer into `stats`.
+ *
+ * Returns `IO_ERR_UNSUPPORTED` (and zeroes `stats`) if the library was
+ * compiled without `IO_STATS`.
+ */
+IO_Err io_reader_stats(IO_Reader *r, IO_ReaderStats *stats);
+
+/**
+ * Resets the instrumentation counters of reader (`r`) and its buffer. The
+ * peak occupancy starts over from the number of bytes currently buffered.
+ *
+ * Returns `IO_ERR_UNSUPPORTED` if the library was compiled without
+ * `IO_STATS`.
+ */
+IO_Err io_reader_stats_reset(IO_Reader *r);
+
+#ifndef __STDC_NO_ATOMICS__
+/**
+ * Attaches histogram `h` to reader (`r`): the duration of every event `ev`
+ * of the reader is recorded into it by the default trace hooks (see
+ * `IO_TRACE_BEGIN`). Pass NULL to detach. The same histogram may be attached
+ * to many readers, owned by any threads.
+ *
+ * Returns `IO_ERR_UNSUPPORTED` if the library was compiled without
+ * `IO_TRACE`, and `IO_ERR_OOB` if `ev` is not a valid event.
+ */
+IO_Err io_reader_trace(IO_Reader *r, IO_TraceEvent ev, IO_Histogram *h);
+#endif // __STDC_NO_ATOMICS__
+
 /**
  * Returns number of buffered bytes by reader (`r`).
  *
@@ -178,7 +916,9 @@ size_t io_reader_buffered(IO_Reader *r);
  * buffer so future peeks or reads see the same data.
  *
  * If data is already buffered, it copies up to `n` bytes from the buffer into
- * dest without consuming them.
+ * dest without consuming them. With read-ahead enabled (see
+ * io_reader_set_readahead()), an empty buffer is filled first with
+ * io_reader_fill() and the peek is served from it.
  *
  * If fewer than n bytes are available, returns IO_ERR_PARTIAL and copies what
  * was read (or buffered). This does not imply EOF — only that less data was
@@ -196,22 +936,99 @@ IO_Err io_reader_npeek(IO_Reader *r, char *dest, size_t n);
  * appended to `dest`. Unlike `io_reader_npeek`, this operation advances the
  * reader's position and discards consumed data from the buffer.
  *
+ * With read-ahead enabled (see io_reader_set_readahead()), requests smaller
+ * than the buffer capacity are read through the internal buffer instead, so
+ * the bytes following them are kept buffered.
+ *
  * If fewer than n bytes are available, returns IO_ERR_PARTIAL and copies what
  * was read. This does not imply EOF — only that less data was available
  * now. If the stream is closed (EOF), returns IO_ERR_EOF.
  */
 IO_Err io_reader_nread(IO_Reader *r, char *dest, size_t n);
 
+/**
+ * Same as io_reader_nread(), but keeps reading until exactly `n` bytes are
+ * copied into `dest`, the stream is closed or the file descriptor would block.
+ *
+ * Once the buffered data is drained, every read goes straight into `dest`
+ * with one vectored read (`IO_READV`) that also tops up the internal buffer
+ * with whatever follows, so `n` may be much larger than the buffer capacity
+ * and bulk transfers cost about one syscall per `n` bytes.
+ *
+ * Returns `IO_ERR_OK` once `n` bytes are read and `IO_ERR_PARTIAL` if the
+ * stream was closed after fewer bytes. If the file descriptor would block,
+ * returns `IO_ERR_AGAIN`: the bytes read so far (see `pos`) stay in `dest`,
+ * so the caller may resume with the rest of the request.
+ */
+IO_Err io_reader_nread_full(IO_Reader *r, char *dest, size_t n);
+
+/**
+ * Same as io_reader_nread_full(), but scatters the data over the `cnt`
+ * regions described by `iov`, filling them in order (e.g. a header struct
+ * followed by a separately allocated payload).
+ *
+ * The buffered data is copied into the first regions. The rest is read with
+ * one vectored read (`IO_READV`) straight into the remaining regions followed
+ * by the free space of the internal buffer for read-ahead, so a message split
+ * over several regions usually takes a single syscall and no extra copies.
+ * At most `IO_READV_MAX - 1` caller regions go into one read.
+ *
+ * Returns the same values as io_reader_nread_full(); `r->pos` tells how many
+ * bytes were scattered on `IO_ERR_PARTIAL` or `IO_ERR_AGAIN`.
+ */
+IO_Err io_reader_nreadv(IO_Reader *r, const IO_Span *iov, int cnt);
+
+/**
+ * Reads up to `n` bytes from the reader's (`r`) file descriptor directly into
+ * the free space of its internal buffer, without an intermediate copy.
+ *
+ * Performs a single read into the free region starting at the buffer's end.
+ * If that region wraps past the end of the underlying storage, both free
+ * segments are filled with one vectored read (`IO_READV`). If the buffer is
+ * empty, it is rewound first so that the whole capacity is available as one
+ * contiguous region. With read-ahead enabled (see io_reader_set_readahead()),
+ * up to the current read-ahead size is requested even if `n` is smaller.
+ *
+ * If `n` exceeds the free space left in the buffer, returns `IO_ERR_OOB`. If
+ * fewer than `n` bytes were read, returns `IO_ERR_PARTIAL`. If the stream is
+ * closed (EOF), returns `IO_ERR_EOF`.
+ */
+IO_Err io_reader_fill(IO_Reader *r, size_t n);
+
+/**
+ * Commits `n` bytes written directly into the reader's (`r`) internal buffer
+ * (see io_buffer_reserve_spans()) as if they were read from the file
+ * descriptor.
+ *
+ * Use it to feed the reader from an external source. Fails with `IO_ERR_OOB`
+ * under the same conditions as io_buffer_commit().
+ */
+IO_Err io_reader_commit(IO_Reader *r, size_t n);
+
 /**
  * Ensures that at least `n` bytes are available in the reader's (`r`)
- * internal buffer by performing a non-advancing read (peek) operation.
+ * internal buffer without consuming them.
  *
- * This function allocates a temporary buffer of size `n` and calls
- * io_reader_npeek() to read or fetch data into the internal buffer without
- * consuming it. The temporary buffer is freed immediately after use.
+ * If fewer than `n` bytes are buffered, the missing bytes are requested with a
+ * single io_reader_fill(), that is, straight from the file descriptor into the
+ * free space of the buffer. Already buffered data is kept as is.
+ *
+ * If `n` exceeds the buffer capacity, returns `IO_ERR_OOB`. If fewer than `n`
+ * bytes are buffered after the read, returns `IO_ERR_PARTIAL`. Returns
+ * `IO_ERR_EOF` only if the stream is closed and nothing is buffered.
  */
 IO_Err io_reader_prefetch(IO_Reader *r, size_t n);
 
+/**
+ * Same as io_reader_prefetch(), but keeps reading until at least `n` bytes
+ * are buffered, the stream is closed or the file descriptor would block.
+ *
+ * Returns `IO_ERR_OK` once `n` bytes are buffered, `IO_ERR_AGAIN` if the file
+ * descriptor would block (whatever was read is kept buffered) and
+ * `IO_ERR_PARTIAL` if the stream was closed with some data buffered.
+ */
+IO_Err io_reader_prefetch_all(IO_Reader *r, size_t n);
+
 /**
  * Consumes up to `n` bytes from reader (`r`)'s internal buffer, copying
  * consumed data into `dest` (if non-NULL) and advancing the reader's position
@@ -237,13 +1054,764 @@ IO_Err io_reader_nconsume(IO_Reader *r, char *dest, size_t n);
  */
 IO_Err io_reader_discard(IO_Reader *r);
 
-#endif // IO_H
+/**
+ * Reads the next record terminated by the `dlen`-byte delimiter `delim` (a
+ * single byte like `"\0"`, or a sequence like `"\r\n"`) from reader (`r`)
+ * and consumes it together with the delimiter.
+ *
+ * On success `rec` describes the record **without** the delimiter. If the
+ * record is contiguous in the reader's internal buffer, `rec->ptr` points
+ * directly into the buffer. Otherwise (the record wraps around) the record is
+ * copied into `scratch`, which must be able to hold `maxlen` bytes. For
+ * mirrored buffers (see io_buffer_init_mirrored()) `scratch` is never used and
+ * may be NULL. Either way the record stays valid until the next operation on
+ * the reader.
+ *
+ * The function fills the internal buffer from the file descriptor as needed,
+ * reading as much as fits in the buffer's free space at once.
+ *
+ * Returns:
+ * - `IO_ERR_OK` if a delimited record was read;
+ * - `IO_ERR_PARTIAL` if the stream was closed before a delimiter was found
+ *   (`rec` then holds the rest of the stream);
+ * - `IO_ERR_EOF` if the stream was closed and nothing is buffered;
+ * - `IO_ERR_AGAIN` if the file descriptor would block before a delimiter was
+ *   found (the data read so far stays buffered);
+ * - `IO_ERR_OOB` if no delimiter was found within `maxlen` bytes or the
+ *   record with its delimiter does not fit into the buffer. The buffered data
+ *   is left untouched, so the caller may skip it with io_reader_nconsume().
+ */
+IO_Err io_reader_read_until(IO_Reader *r, const char *delim, size_t dlen,
+                            IO_Span *rec, char *scratch, size_t maxlen);
 
-#ifdef IO_IMPL
-#  ifndef IO_IMPL_GUARD
-#    define IO_IMPL_GUARD
+/**
+ * Reads the next line terminated by LF or CRLF from reader (`r`). The line
+ * terminator is consumed but not included in `line`.
+ *
+ * Same as io_reader_read_until() with the `"\n"` delimiter, except that a
+ * trailing CR is also stripped from `line`.
+ */
+IO_Err io_reader_readline(IO_Reader *r, IO_Span *line, char *scratch, size_t maxlen);
 
-#include <string.h>
+/**
+ * Batch version of io_reader_read_until(): describes up to `*nrecs` records
+ * terminated by `delim` in `recs` and sets `*nrecs` to the number of records
+ * read.
+ *
+ * Every complete record that is already buffered is taken without reading
+ * from the file descriptor; only if there is none, the reader is filled
+ * until there is one (see io_reader_read_until()), and the complete records
+ * that came with it are taken as well. The records are then consumed at
+ * once, so a read that delivers many pipelined messages costs a single call.
+ *
+ * Records point directly into the internal buffer, except for the one
+ * record that may wrap around it, which is copied into `scratch` (able to
+ * hold `maxlen` bytes, and may be NULL for mirrored buffers). They stay
+ * valid until the next operation on the reader.
+ *
+ * The batch stops before the first record that is longer than `maxlen` (or
+ * wraps with NULL `scratch`). Returns what io_reader_read_until() returns
+ * for the first record: `*nrecs` is 1 for `IO_ERR_PARTIAL` (the rest of the
+ * stream) and 0 for other errors.
+ */
+IO_Err io_reader_read_records(IO_Reader *r, const char *delim, size_t dlen, IO_Span *recs,
+                              size_t *nrecs, char *scratch, size_t maxlen);
+
+/**
+ * Payload of a length-prefixed frame read by io_reader_read_frame_*():
+ * `len` bytes made up of `nspans` spans (0 for an empty payload, 2 if it
+ * wraps around the reader's internal buffer).
+ */
+typedef struct {
+    IO_Span spans[2];
+    size_t nspans, len;
+} IO_Frame;
+
+/**
+ * Fixed-width frame headers: `XX(name, width, big_endian)`. Every entry
+ * declares a separate io_reader_read_frame_<name>() function, so the header
+ * is decoded with its width and byte order known at compile time.
+ */
+#define IO_FRAME_MAP(XX)                        \
+    XX(u8,    1, 0)                             \
+    XX(u16be, 2, 1)                             \
+    XX(u16le, 2, 0)                             \
+    XX(u32be, 4, 1)                             \
+    XX(u32le, 4, 0)                             \
+    XX(u64be, 8, 1)                             \
+    XX(u64le, 8, 0)
+
+/**
+ * Reads the next frame, a length header followed by that many bytes of
+ * payload, from reader (`r`) and consumes it. The header is an unsigned
+ * integer of the width and byte order given by the function name (see
+ * `IO_FRAME_MAP`), or an unsigned LEB128 varint of up to 10 bytes for
+ * io_reader_read_frame_varint().
+ *
+ * The header is decoded in place and the buffer is filled until the whole
+ * frame is buffered. `f` then describes the payload directly in the internal
+ * buffer (in two spans if it wraps around; mirrored buffers always give
+ * one), valid until the next operation on the reader. Frames that can't fit
+ * into the buffer (see io_buffer_init_growable()) are read straight into
+ * `dest` instead (see io_reader_nread_full()), which `f` points to then;
+ * pass NULL to reject them with `IO_ERR_OOB`.
+ *
+ * Returns:
+ * - `IO_ERR_OK` if a whole frame was read;
+ * - `IO_ERR_EOF` if the stream was closed and nothing is buffered;
+ * - `IO_ERR_PARTIAL` if the stream was closed in the middle of a frame;
+ * - `IO_ERR_AGAIN` if the file descriptor would block before the frame is
+ *   complete (the data read so far stays buffered, so the call may be
+ *   repeated);
+ * - `IO_ERR_OOB` if the payload is longer than `maxlen`, does not fit and
+ *   `dest` is NULL, or the varint is malformed. Nothing is consumed.
+ *
+ * NOTE: A frame read into `dest` is consumed even if the read fails, so use
+ *       this path on blocking file descriptors only.
+ */
+#define XX(name, width, big_endian)                                     \
+    IO_Err io_reader_read_frame_##name(IO_Reader *r, IO_Frame *f, char *dest, size_t maxlen);
+IO_FRAME_MAP(XX)
+#undef XX
+IO_Err io_reader_read_frame_varint(IO_Reader *r, IO_Frame *f, char *dest, size_t maxlen);
+
+/**
+ * Batch version of io_reader_read_frame_*(): describes up to `*nframes`
+ * frames in `frames` and sets `*nframes` to the number of frames read.
+ *
+ * Every complete frame that is already buffered is taken without reading
+ * from the file descriptor; only if there is none, the reader reads as much
+ * as fits into the buffer (and then until there is a complete frame, as
+ * io_reader_read_frame_*() with NULL `dest` does), and all the complete
+ * frames that came with it are taken. The frames
+ * are then consumed at once. Payloads stay valid until the next operation on
+ * the reader.
+ *
+ * The batch stops before the first frame that is incomplete or longer than
+ * `maxlen`. Returns what io_reader_read_frame_*() returns for the first
+ * frame, with `*nframes == 0` unless it is `IO_ERR_OK`.
+ */
+#define XX(name, width, big_endian)                                     \
+    IO_Err io_reader_read_frames_##name(IO_Reader *r, IO_Frame *frames, size_t *nframes, size_t maxlen);
+IO_FRAME_MAP(XX)
+#undef XX
+IO_Err io_reader_read_frames_varint(IO_Reader *r, IO_Frame *frames, size_t *nframes, size_t maxlen);
+
+/**
+ * Writer entity.
+ *
+ * Represents a file descriptor writer with an associated IO_Buffer. Small
+ * writes are coalesced in the buffer and sent to the file descriptor in one
+ * go by io_writer_flush() (or when the buffer runs out of space).
+ *
+ * `nwritten` counts the bytes accepted from the caller, `nflushed` - the bytes
+ * actually written to the file descriptor. `nwritten - nflushed` equals the
+ * number of bytes currently buffered (see io_writer_pending()).
+ *
+ * The file descriptor may be non-blocking, following the same contract as
+ * `IO_Reader`: if it would block, `IO_ERR_AGAIN` is returned and the writer
+ * stays consistent, so the call may be repeated once the file descriptor
+ * becomes writable.
+ */
+typedef struct {
+    IO_Buffer *b;
+    size_t nwritten, nflushed;
+    int fd;
+} IO_Writer;
+
+/**
+ * Initializes writer `w` with IO Buffer `b` and a file descriptor `fd`.
+ */
+IO_Err io_writer_init(IO_Writer *w, IO_Buffer *b, int fd);
+
+/**
+ * Returns number of bytes buffered by writer (`w`) that were not written to
+ * the file descriptor yet.
+ */
+size_t io_writer_pending(IO_Writer *w);
+
+/**
+ * Writes `n` bytes from `src` through writer (`w`).
+ *
+ * If the data fits into the free space of the internal buffer, it is only
+ * appended to the buffer. Otherwise the buffered data and `src` are written
+ * to the file descriptor together with a single vectored write
+ * (`IO_WRITEV`), bypassing the buffer for `src`. Short writes are continued
+ * until the rest of `src` fits into the buffer.
+ *
+ * Returns `IO_ERR_AGAIN` if the file descriptor would block before all `n`
+ * bytes were accepted; the number of accepted bytes (written or buffered) is
+ * reflected in `w->nwritten`. Returns `IO_ERR_FAILED_WRITE` on other errors.
+ */
+IO_Err io_writer_write(IO_Writer *w, const char *src, size_t n);
+
+/**
+ * Writes all data buffered by writer (`w`) to the file descriptor.
+ *
+ * Returns `IO_ERR_AGAIN` if the file descriptor would block before the buffer
+ * was drained and `IO_ERR_FAILED_WRITE` on other errors.
+ */
+IO_Err io_writer_flush(IO_Writer *w);
+
+/**
+ * Pipe that io_reader_forward() moves data through when neither side of the
+ * transfer is a pipe (e.g. socket to socket), so that the data never gets
+ * copied to user space (Linux only, with `splice(2)`).
+ *
+ * `pending` is the number of bytes that were taken from the source but not
+ * yet written to the destination: they are written first by the next
+ * io_reader_forward() call.
+ */
+typedef struct {
+    int fds[2];
+    size_t pending;
+} IO_Pipe;
+
+/**
+ * Initializes pipe `p`. The callee must free it later using io_pipe_free().
+ *
+ * Returns `IO_ERR_UNSUPPORTED` if the pipe could not be created.
+ */
+IO_Err io_pipe_init(IO_Pipe *p);
+
+/**
+ * Closes pipe `p`. Any pending bytes are lost.
+ */
+IO_Err io_pipe_free(IO_Pipe *p);
+
+/**
+ * Forwards `n` bytes from reader (`r`) to the file descriptor `fd`.
+ *
+ * The data already buffered by the reader is written first (with one
+ * `writev()` over the buffer's spans). The rest goes from the reader's file
+ * descriptor straight to `fd` inside the kernel when possible (Linux):
+ * `copy_file_range()` between regular files, `sendfile()` from a regular
+ * file, `splice()` from a pipe or, through pipe `p`, from any other file
+ * descriptor (e.g. a socket). When none of them applies (no `p`, a custom
+ * source, another platform, ...) the data is read into the reader's buffer
+ * and written from there.
+ *
+ * Everything forwarded counts as read and consumed: `r->nread` and `r->pos`
+ * both advance by the number of bytes written to `fd` (use `r->pos` to tell
+ * how many were on `IO_ERR_PARTIAL` or `IO_ERR_AGAIN`).
+ *
+ * Returns:
+ * - `IO_ERR_OK` if `n` bytes were forwarded;
+ * - `IO_ERR_PARTIAL` if the stream was closed after some bytes were forwarded;
+ * - `IO_ERR_EOF` if the stream was closed and nothing was forwarded;
+ * - `IO_ERR_AGAIN` if either file descriptor would block (the call may be
+ *   repeated with the rest of `n`);
+ * - `IO_ERR_FAILED_READ`/`IO_ERR_FAILED_WRITE` on other failures.
+ */
+IO_Err io_reader_forward(IO_Reader *r, int fd, size_t n, IO_Pipe *p);
+
+/**
+ * Flags passed to `IO_Codec.step`.
+ *
+ * - `IO_CODEC_FLUSH`: produce everything that can be decoded from the input
+ *   consumed so far (e.g. `ZSTD_e_flush`, `Z_SYNC_FLUSH`).
+ * - `IO_CODEC_END`: there is no more input: finish the stream (e.g.
+ *   `ZSTD_e_end`, `Z_FINISH`).
+ */
+typedef enum {
+    IO_CODEC_FLUSH = 1 << 0,
+    IO_CODEC_END   = 1 << 1,
+} IO_CodecFlags;
+
+/**
+ * Streaming codec (e.g. a zstd or lz4 compression or decompression stream)
+ * used by `IO_Decoder` and `IO_Encoder`.
+ *
+ * `step` consumes up to `*nin` bytes from `in` and produces up to `*nout`
+ * bytes into `out`, and sets `*nin` and `*nout` to the numbers of bytes
+ * actually consumed and produced. `flags` is a combination of
+ * `IO_CodecFlags`. Input that can't be processed yet (e.g. an incomplete
+ * block) must be consumed and kept in the codec's state: leaving input
+ * unconsumed while there is free output space means the data is malformed.
+ *
+ * Returns `IO_ERR_OK` while there is more to do, `IO_ERR_EOF` once the end of
+ * the compressed stream was decoded (or, with `IO_CODEC_FLUSH`/`IO_CODEC_END`,
+ * once all pending output was produced) and any other error on failure.
+ * `ctx` is passed as is.
+ */
+typedef struct {
+    IO_Err (*step)(void *ctx, const char *in, size_t *nin, char *out, size_t *nout, int flags);
+    void *ctx;
+} IO_Codec;
+
+/**
+ * Decompressing reader stage: decodes the data read by reader `src` with
+ * `codec`. See io_reader_init_decoder().
+ *
+ * `eof` is set once `src` reached the end of stream and `done` once the
+ * codec reported the end of the decoded stream. `err` is the last error
+ * returned by the codec.
+ */
+typedef struct {
+    IO_Reader *src;
+    IO_Codec codec;
+    bool eof, done;
+    IO_Err err;
+} IO_Decoder;
+
+/**
+ * Initializes reader `r` with IO Buffer `b`, that reads the data decoded by
+ * decoder `d` from the compressed stream of reader `src` (which has its own
+ * buffer).
+ *
+ * The codec reads the compressed data in place from the spans of `src`'s
+ * buffer and writes the decoded data straight into the free spans of `b`
+ * (`r` uses `d` as its `IO_Source`), so there is no intermediate copy and
+ * all `io_reader_*` functions, including peeks and the span API, work on the
+ * decoded data. `d` must outlive `r`.
+ *
+ * If `src` would block, `r` returns `IO_ERR_AGAIN` as usual. If the codec
+ * fails, `r` returns `IO_ERR_FAILED_READ` and the codec's error is kept in
+ * `d->err`. Once the codec decoded the end of the stream, `r` reports
+ * end of file, even if `src` has more data.
+ */
+IO_Err io_reader_init_decoder(IO_Reader *r, IO_Buffer *b, IO_Decoder *d,
+                              IO_Reader *src, const IO_Codec *codec);
+
+/**
+ * Compressing writer stage: encodes the data written into it with `codec` and
+ * writes the result through writer `dst`.
+ *
+ * `nwritten` counts the bytes accepted from the caller (before encoding).
+ */
+typedef struct {
+    IO_Writer *dst;
+    IO_Codec codec;
+    size_t nwritten;
+} IO_Encoder;
+
+/**
+ * Initializes encoder `e` that writes the data encoded by `codec` through
+ * writer `dst`.
+ */
+IO_Err io_encoder_init(IO_Encoder *e, IO_Writer *dst, const IO_Codec *codec);
+
+/**
+ * Encodes `n` bytes from `src` with encoder `e`.
+ *
+ * The codec writes straight into the free spans of the buffer of `e->dst`,
+ * which is flushed whenever it runs out of space. Same as io_writer_write():
+ * returns `IO_ERR_AGAIN` if the file descriptor would block before all `n`
+ * bytes were accepted (see `e->nwritten`).
+ */
+IO_Err io_encoder_write(IO_Encoder *e, const char *src, size_t n);
+
+/**
+ * Encodes everything accepted by encoder `e` so far (`IO_CODEC_FLUSH`) and
+ * flushes `e->dst`, so the receiver can decode all of it.
+ */
+IO_Err io_encoder_flush(IO_Encoder *e);
+
+/**
+ * Finishes the stream of encoder `e` (`IO_CODEC_END`) and flushes `e->dst`.
+ * Nothing may be written into the encoder afterwards.
+ */
+IO_Err io_encoder_finish(IO_Encoder *e);
+
+#if defined(IO_URING) && defined(__linux__)
+/**
+ * Asynchronous IO engine based on io_uring (Linux only, enabled by defining
+ * `IO_URING`).
+ *
+ * The engine drives a fixed set of readers and writers. The storage of every
+ * reader's and writer's buffer is registered with the kernel as a fixed
+ * buffer. Reads are submitted straight into the free space of the readers'
+ * buffers: when a read completes, the read bytes are committed to the reader
+ * (advancing `nread` and the buffer's end) as if they were read by
+ * io_reader_fill(). Writes are submitted straight from the data buffered by
+ * the writers: when a write completes, the written bytes are consumed from
+ * the writer's buffer (advancing `nflushed`) as if they were written by
+ * io_writer_flush().
+ *
+ * Reads and writes for all readers and writers are submitted, and their
+ * completions reaped, in batches with a single `io_uring_enter` system call
+ * (see io_async_run()).
+ *
+ * `inflight` and `active` are indexed by slot: slot `i` is reader `i` for
+ * `i < nreaders` and writer `i - nreaders` otherwise. A reader whose read
+ * completes with end of file or an error, or a writer whose write fails, is
+ * made inactive (`active[i]` is false), so nothing more is submitted for it
+ * until it is made active again with io_async_set_active() or
+ * io_async_set_writer_active(). `ninflight` is the number of operations
+ * submitted and not reaped yet. `err` is the error of the last failed
+ * `io_uring_enter` call.
+ *
+ * NOTE: While a read is in flight for a reader, the reader must only be
+ *       consumed from (e.g. io_reader_nconsume()); functions that read from
+ *       the file descriptor or write into the buffer must not be called.
+ *       While a write is in flight for a writer, the writer must not be
+ *       written to or flushed.
+ * NOTE: Readers with a custom source (see `IO_Source`) and readers or writers
+ *       with a growable buffer are not supported. Pooled buffers must not be
+ *       detached while registered.
+ */
+typedef struct {
+    int fd;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_sz, cq_ring_sz, sqes_sz;
+    unsigned sq_entries;
+    IO_Reader **readers;
+    IO_Writer **writers;
+    bool *inflight, *active;
+    struct iovec *iov;
+    size_t nreaders, nwriters, ninflight;
+    bool fixed;
+    IO_Err err;
+} IO_Async;
+
+/**
+ * Result of a completed read for reader `r` (`w` is NULL) or of a completed
+ * write for writer `w` (`r` is NULL).
+ *
+ * For a read, `err` is `IO_ERR_OK` if data was committed to the reader,
+ * `IO_ERR_EOF` if the stream was closed, `IO_ERR_AGAIN` if the file
+ * descriptor had no data and `IO_ERR_FAILED_READ` on other errors. For a
+ * write, `err` is `IO_ERR_OK` if data was consumed from the writer's buffer,
+ * `IO_ERR_AGAIN` if the file descriptor would block and
+ * `IO_ERR_FAILED_WRITE` on other errors (including a write that wrote
+ * nothing).
+ */
+typedef struct {
+    IO_Reader *r;
+    IO_Writer *w;
+    IO_Err err;
+} IO_AsyncEvent;
+
+/**
+ * Initializes engine `a` for `nreaders` readers from `readers` and registers
+ * their buffers' storage with the kernel.
+ *
+ * If registering fixed buffers is not permitted (e.g. because of
+ * `RLIMIT_MEMLOCK`), the engine falls back to regular vectored reads, which
+ * fill both free segments of a wrapped buffer.
+ * Returns `IO_ERR_UNSUPPORTED` if io_uring is not available. The caller must
+ * free the engine later with io_async_free().
+ */
+IO_Err io_async_init(IO_Async *a, IO_Reader **readers, size_t nreaders);
+
+/**
+ * Same as io_async_init(), but the engine also drives `nwriters` writers
+ * from `writers` (either count may be 0, but not both).
+ */
+IO_Err io_async_init_rw(IO_Async *a, IO_Reader **readers, size_t nreaders,
+                        IO_Writer **writers, size_t nwriters);
+
+/**
+ * Releases all resources held by engine `a`. The readers and writers are left
+ * intact.
+ */
+IO_Err io_async_free(IO_Async *a);
+
+/**
+ * Makes reader `r` of engine `a` active (reads are submitted for it) or
+ * inactive (e.g. once its connection is closed). A read already in flight
+ * still completes and is reported.
+ *
+ * Returns `IO_ERR_OOB` if `r` is not one of the engine's readers.
+ */
+IO_Err io_async_set_active(IO_Async *a, IO_Reader *r, bool active);
+
+/**
+ * Same as io_async_set_active(), but for writer `w` of engine `a`.
+ */
+IO_Err io_async_set_writer_active(IO_Async *a, IO_Writer *w, bool active);
+
+/**
+ * Submits a read for every active reader of engine `a` that has no read in
+ * flight and has free space in its buffer, and a write for every active
+ * writer that has no write in flight and has data buffered. Then waits until
+ * at least `min_complete` operations complete, and stores up to `max`
+ * completions into `events`. Submission and waiting are done with a single
+ * system call.
+ *
+ * `min_complete` is clamped to the number of operations in flight, so the
+ * call does not block when there is nothing to read into or to write.
+ *
+ * Returns the number of events stored. Completions that did not fit into
+ * `events` are reported by the next call. If `io_uring_enter` fails, returns
+ * 0 and sets `a->err` to `IO_ERR_FAILED_READ` (`IO_ERR_OK` otherwise).
+ */
+size_t io_async_run(IO_Async *a, IO_AsyncEvent *events, size_t max, unsigned min_complete);
+#endif // IO_URING && __linux__
+
+#if defined(IO_SERVER) && !defined(IO_LOOP)
+#  define IO_LOOP
+#endif // IO_SERVER
+
+#if defined(IO_LOOP) && defined(__linux__)
+#  define IO_LOOP_EPOLL
+#elif defined(IO_LOOP) && (defined(__APPLE__) || defined(__FreeBSD__) || \
+                           defined(__OpenBSD__) || defined(__NetBSD__))
+#  define IO_LOOP_KQUEUE
+#endif
+
+#if defined(IO_LOOP_EPOLL) || defined(IO_LOOP_KQUEUE)
+#ifndef IO_LOOP_MAX_EVENTS
+#  define IO_LOOP_MAX_EVENTS 64
+#endif // IO_LOOP_MAX_EVENTS
+
+struct IO_Loop;
+
+/**
+ * Connection driven by an `IO_Loop` (enabled by defining `IO_LOOP`; uses
+ * epoll on Linux and kqueue on BSD and macOS).
+ *
+ * `r` reads from the connection's file descriptor, which must be
+ * non-blocking. Whenever it becomes readable, the loop fills `r`'s buffer
+ * until the file descriptor would block and after every read calls `on_data`
+ * with the spans of everything buffered (see io_buffer_peek_spans()).
+ * `on_data` returns how many of those bytes it consumed; the rest stays
+ * buffered and is passed again with the next data. It may also consume
+ * through `r` itself (e.g. with io_reader_readline()) and return 0.
+ *
+ * If the buffer is full and `on_data` consumed nothing, a growable buffer
+ * (see io_buffer_init_growable()) grows, up to its `max_cap`. Otherwise the
+ * loop stops reading from the connection (backpressure) until
+ * io_loop_resume() is called, which lets slow consumers hold data without
+ * the loop spinning.
+ *
+ * `w` (optional) writes into the same file descriptor: the loop flushes it
+ * whenever the file descriptor becomes writable, so `on_data` may write
+ * responses with io_writer_write() and leave `IO_ERR_AGAIN` to the loop.
+ *
+ * `on_close` (optional) is called once the connection is removed from the
+ * loop because the stream was closed (`IO_ERR_EOF`) or a read or write
+ * failed. The loop doesn't touch the connection afterwards, so `on_close` may
+ * close the file descriptor and free the connection.
+ *
+ * If `r` is NULL, the loop only watches `fd` for readability and calls
+ * `on_data` without spans whenever it becomes readable (e.g. to accept
+ * connections on a listening socket until `accept` would block).
+ */
+typedef struct IO_Conn {
+    IO_Reader *r;
+    IO_Writer *w;
+    int fd;
+    size_t (*on_data)(struct IO_Loop *l, struct IO_Conn *c, const IO_Span *spans, size_t nspans);
+    void (*on_close)(struct IO_Loop *l, struct IO_Conn *c, IO_Err err);
+    void *ctx;
+    unsigned state;
+} IO_Conn;
+
+/**
+ * One-shot timer of an `IO_Loop`. `cb` is called once `deadline` (in
+ * milliseconds of the monotonic clock) passes; it may add the timer again to
+ * make it periodic. Zero-initialize timers before they are first added.
+ */
+typedef struct IO_Timer {
+    void (*cb)(struct IO_Loop *l, struct IO_Timer *t);
+    void *ctx;
+    uint64_t deadline;
+    size_t idx;
+} IO_Timer;
+
+/**
+ * Event loop driving many `IO_Conn`s and `IO_Timer`s on one thread.
+ *
+ * The file descriptors are watched in edge-triggered mode, and every
+ * readiness event is drained until `IO_ERR_AGAIN` (see `IO_Reader`), so one
+ * wakeup costs one `epoll_wait`/`kevent` call for up to
+ * `IO_LOOP_MAX_EVENTS` connections. Timers are kept in a binary heap, and the
+ * nearest deadline bounds how long the loop sleeps.
+ *
+ * NOTE: The loop is not thread-safe. Run one loop per thread.
+ */
+typedef struct IO_Loop {
+    int fd;
+    void *events;
+    int nevents, cur;
+    IO_Conn *current;
+    IO_Timer **timers;
+    size_t ntimers, timers_cap;
+    bool stop;
+} IO_Loop;
+
+/**
+ * Initializes event loop `l`. The caller must free it later with
+ * io_loop_free().
+ */
+IO_Err io_loop_init(IO_Loop *l);
+
+/**
+ * Releases all resources held by event loop `l`. Connections and timers are
+ * left intact.
+ */
+IO_Err io_loop_free(IO_Loop *l);
+
+/**
+ * Starts watching connection `c` in event loop `l`. Data that is already
+ * buffered by `c->r` is handled on the next readiness event.
+ */
+IO_Err io_loop_add(IO_Loop *l, IO_Conn *c);
+
+/**
+ * Stops watching connection `c` in event loop `l` without calling
+ * `on_close`. May be called from any callback, including `c`'s own
+ * `on_data`, which may then free `c` right away.
+ */
+IO_Err io_loop_remove(IO_Loop *l, IO_Conn *c);
+
+/**
+ * Resumes reading from connection `c` of event loop `l` after the loop
+ * stopped because its buffer was full: the buffered data is passed to
+ * `on_data` again and the connection is read until it would block.
+ */
+IO_Err io_loop_resume(IO_Loop *l, IO_Conn *c);
+
+/**
+ * Arms timer `t` of event loop `l` to fire in `ms` milliseconds. Re-arms it
+ * if it is armed already.
+ */
+IO_Err io_loop_add_timer(IO_Loop *l, IO_Timer *t, uint64_t ms);
+
+/**
+ * Disarms timer `t` of event loop `l` if it is armed.
+ */
+IO_Err io_loop_cancel_timer(IO_Loop *l, IO_Timer *t);
+
+/**
+ * Waits for at most `timeout` milliseconds (forever if negative, but never
+ * past the nearest timer) for readiness events, handles them and fires the
+ * expired timers.
+ *
+ * Returns `IO_ERR_FAILED_READ` if waiting for events failed.
+ */
+IO_Err io_loop_run_once(IO_Loop *l, int timeout);
+
+/**
+ * Runs event loop `l` until io_loop_stop() is called.
+ */
+IO_Err io_loop_run(IO_Loop *l);
+
+/**
+ * Makes io_loop_run() of event loop `l` return after handling the current
+ * events.
+ */
+IO_Err io_loop_stop(IO_Loop *l);
+
+#ifdef IO_SERVER
+#include <pthread.h>
+#include <sys/socket.h>
+
+struct IO_Server;
+
+/**
+ * Worker of an `IO_Server`: a thread with its own event loop, buffer pool and
+ * listening socket.
+ *
+ * Everything a worker touches while serving its connections belongs to it,
+ * so workers share no state on the hot path. The loop and the pool are
+ * created on the worker's thread (after it is pinned, if requested), so their
+ * memory is allocated local to the worker's core and NUMA node.
+ */
+typedef struct IO_Worker {
+    IO_Loop loop;
+    IO_BufferPool pool;
+    IO_Conn listener, wakeup;
+    int wakeup_fds[2];
+    size_t index;
+    struct IO_Server *server;
+    pthread_t thread;
+    IO_Err err;
+} IO_Worker;
+
+/**
+ * Configuration of an `IO_Server`.
+ *
+ * `addr` (of `addrlen` bytes) is the address to listen on. If its port is 0,
+ * the first worker binds an ephemeral port and the others use the same one
+ * (see `IO_Server`'s `addr`).
+ *
+ * `nworkers` is the number of worker threads (0: one per online CPU), `pin` -
+ * whether to pin worker `i` to CPU `i` (Linux only, ignored elsewhere; if a
+ * worker cannot be pinned, io_server_run() fails with its error).
+ * `buffer_cap` and `pool_blocks` configure each worker's `pool` (see
+ * io_buffer_pool_init()).
+ *
+ * `on_accept` is called on the worker's thread for every accepted
+ * connection `fd` (already non-blocking); it typically sets up an `IO_Conn`
+ * with buffers from `w->pool` and adds it to `w->loop`. `on_stop`
+ * (optional) is called on the worker's thread after its loop stopped, to
+ * release the connections it still holds. `ctx` is for the caller's use.
+ */
+typedef struct {
+    const struct sockaddr *addr;
+    socklen_t addrlen;
+    size_t nworkers;
+    bool pin;
+    size_t buffer_cap, pool_blocks;
+    void (*on_accept)(IO_Worker *w, int fd);
+    void (*on_stop)(IO_Worker *w);
+    void *ctx;
+} IO_ServerConfig;
+
+/**
+ * Multi-threaded server that runs one `IO_Loop` per worker thread (enabled by
+ * defining `IO_SERVER`, which implies `IO_LOOP`).
+ *
+ * Each worker has its own listening socket bound to the same address with
+ * `SO_REUSEPORT`, so the kernel spreads incoming connections across workers
+ * and every connection lives on the worker that accepted it.
+ *
+ * `addr` holds the address the listeners are actually bound to.
+ */
+typedef struct IO_Server {
+    IO_ServerConfig cfg;
+    IO_Worker *workers;
+    size_t nworkers;
+    struct sockaddr_storage addr;
+} IO_Server;
+
+/**
+ * Initializes server `s` with configuration `cfg` (copied), creating and
+ * binding the listening sockets of all workers.
+ *
+ * Returns `IO_ERR_UNSUPPORTED` if the platform has no `SO_REUSEPORT` or the
+ * address could not be bound. The caller must free the server later with
+ * io_server_free().
+ */
+IO_Err io_server_init(IO_Server *s, const IO_ServerConfig *cfg);
+
+/**
+ * Starts the worker threads of server `s` and waits until all of them stop
+ * (see io_server_stop()).
+ *
+ * Returns `IO_ERR_OOM` if a worker could not be started (the others are
+ * stopped then) or the first error a worker failed with (e.g.
+ * `IO_ERR_UNSUPPORTED` if it could not be pinned, see `IO_ServerConfig`).
+ */
+IO_Err io_server_run(IO_Server *s);
+
+/**
+ * Asks all workers of server `s` to stop. Safe to call from any thread,
+ * including the workers' callbacks.
+ */
+IO_Err io_server_stop(IO_Server *s);
+
+/**
+ * Closes the listening sockets of server `s` and releases its memory.
+ */
+IO_Err io_server_free(IO_Server *s);
+#endif // IO_SERVER
+#endif // IO_LOOP_EPOLL || IO_LOOP_KQUEUE
+
+#endif // IO_H
+
+#ifdef IO_IMPL
+#  ifndef IO_IMPL_GUARD
+#    define IO_IMPL_GUARD
+
+#include <errno.h>
+#include <string.h>
 
 #ifndef IO_ASSERT
 #  ifdef _DEBUG
@@ -254,235 +1822,2930 @@ IO_Err io_reader_discard(IO_Reader *r);
 #  endif // _DEBUG
 #endif // IO_ASSERT
 
-#ifndef IO_MALLOC
-#  include <stdlib.h>
-#  define IO_MALLOC malloc
-#endif // IO_MALLOC
+#ifdef IO_STATS
+#  define _IO_STAT(expr) do { expr; } while(0)
+#else // IO_STATS
+#  define _IO_STAT(expr) do {} while(0)
+#endif // IO_STATS
+
+/**
+ * Trace hooks around the events of readers (see `IO_TraceEvent`).
+ *
+ * `IO_TRACE_BEGIN(r, ev)` is expanded right before event `ev` of reader `r`
+ * and `IO_TRACE_END(r, ev, n)` right after it, `n` being the number of bytes
+ * copied or the result of the read. Both are expanded as statements of the
+ * same block, at most one pair per block, so `IO_TRACE_BEGIN` may declare
+ * variables for `IO_TRACE_END`. Hooks that are not defined expand to nothing.
+ *
+ * With `IO_TRACE` defined, the default hooks record the duration of each
+ * event (in `IO_TRACE_CLOCK()` units) into the histogram attached to the
+ * reader with io_reader_trace(). `IO_TRACE_CLOCK()` defaults to
+ * `CLOCK_MONOTONIC` in nanoseconds; define it as e.g. `__rdtsc()` for a
+ * cheaper clock in TSC ticks.
+ */
+#ifdef IO_TRACE
+#  include <time.h>
+#  ifndef IO_TRACE_CLOCK
+#    define IO_TRACE_CLOCK() _io_trace_clock()
+#  endif // IO_TRACE_CLOCK
+#  ifndef IO_TRACE_BEGIN
+#    define IO_TRACE_BEGIN(r, ev) uint64_t _io_trace_start = IO_TRACE_CLOCK()
+#    define IO_TRACE_END(r, ev, n) _io_trace_record((r), (ev), _io_trace_start)
+#  endif // IO_TRACE_BEGIN
+#endif // IO_TRACE
+
+#ifndef IO_TRACE_BEGIN
+#  define IO_TRACE_BEGIN(r, ev) do {} while(0)
+#endif // IO_TRACE_BEGIN
+
+#ifndef IO_TRACE_END
+#  define IO_TRACE_END(r, ev, n) do {} while(0)
+#endif // IO_TRACE_END
+
+#ifndef IO_MALLOC
+#  include <stdlib.h>
+#  define IO_MALLOC malloc
+#endif // IO_MALLOC
+
+#ifndef IO_REALLOC
+#  include <stdlib.h>
+#  define IO_REALLOC realloc
+#endif // IO_REALLOC
+
+#ifndef IO_FREE
+#  include <stdlib.h>
+#  define IO_FREE free
+#endif // IO_FREE
+
+#ifndef IO_BUFFER_POOL_ALIGN
+#  define IO_BUFFER_POOL_ALIGN 64
+#endif // IO_BUFFER_POOL_ALIGN
+
+#ifndef IO_HUGE_PAGE_SIZE
+#  define IO_HUGE_PAGE_SIZE (2 << 20)
+#endif // IO_HUGE_PAGE_SIZE
+
+#ifndef IO_READ
+// TODO: Depending on platform, use different implementations of `read()`
+#  include <unistd.h>
+#  define IO_READ read
+#endif // IO_READ
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+#  include <sys/syscall.h>
+#endif // __linux__
+#ifndef IO_READV
+#  define IO_READV readv
+#endif // IO_READV
+
+#ifndef IO_READV_MAX
+#  define IO_READV_MAX 16
+#endif // IO_READV_MAX
+
+#ifndef IO_WRITE
+#  define IO_WRITE write
+#endif // IO_WRITE
+
+#ifndef IO_WRITEV
+#  define IO_WRITEV writev
+#endif // IO_WRITEV
+
+
+/**
+ * Wrappers around `IO_READ`/`IO_READV` that retry reads interrupted by a
+ * signal.
+ */
+static inline ssize_t _io_read(int fd, void *buf, size_t n) {
+    ssize_t nread;
+    do nread = IO_READ(fd, buf, n); while (nread < 0 && errno == EINTR);
+    return nread;
+}
+
+static inline ssize_t _io_readv(int fd, const struct iovec *iov, int cnt) {
+    ssize_t nread;
+    do nread = IO_READV(fd, iov, cnt); while (nread < 0 && errno == EINTR);
+    return nread;
+}
+
+/**
+ * Maps `errno` of a failed read to `IO_Err`.
+ */
+static inline IO_Err _io_read_err(void) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return IO_ERR_AGAIN;
+    return IO_ERR_FAILED_READ;
+}
+
+/**
+ * Wrapper around `IO_WRITEV` (or `IO_WRITE` if there is only one region to
+ * write) that retries writes interrupted by a signal.
+ */
+static inline ssize_t _io_writev(int fd, const struct iovec *iov, int cnt) {
+    ssize_t nwritten;
+    do {
+        if (cnt == 1) nwritten = IO_WRITE(fd, iov[0].iov_base, iov[0].iov_len);
+        else nwritten = IO_WRITEV(fd, iov, cnt);
+    } while (nwritten < 0 && errno == EINTR);
+    return nwritten;
+}
+
+/**
+ * Maps `errno` of a failed write to `IO_Err`.
+ */
+static inline IO_Err _io_write_err(void) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return IO_ERR_AGAIN;
+    return IO_ERR_FAILED_WRITE;
+}
+
+#ifndef MIN
+#  define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif // MIN
+
+#ifndef MAX
+#  define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif // MAX
+
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__AVX2__))
+#  include <immintrin.h>
+#  define IO_SIMD_FIND_ANY
+#endif
+
+
+const char *io_err_to_cstr(IO_Err err) {
+#define XX(num, name, repr) if (err == num) return repr;
+    IO_ERR_MAP(XX)
+#undef XX
+    IO_ASSERT(0 && "Unreachable");
+    // NOTE: Suppressing warning:
+    //       control reaches end of non-void function [-Wreturn-type]
+    return "";
+}
+
+/**
+ * Returns physical size of the buffer.
+ */
+static inline size_t _io_buffer_size(IO_Buffer *b) {
+    return b->cap + 1;
+}
+
+IO_Err io_buffer_init(IO_Buffer *b, size_t cap) {
+    b->cap = b->min_cap = b->max_cap = cap;
+    b->flags = 0;
+    b->pool = NULL;
+    _IO_STAT(b->stats = (IO_BufferStats){0});
+    b->end = b->start = b->buf = IO_MALLOC(cap + 1);
+    if (b->buf == NULL) return IO_ERR_OOM;
+    return IO_ERR_OK;
+}
+
+/**
+ * Creates an anonymous shared memory object of `size` bytes and returns its
+ * file descriptor, or -1 on failure.
+ */
+static int _io_shm_create(size_t size) {
+    int fd = -1;
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    fd = memfd_create("io_buffer", MFD_CLOEXEC);
+#else
+    static unsigned counter = 0;
+    char name[64];
+    for (int attempt = 0; attempt < 16 && fd < 0; attempt++) {
+        snprintf(name, sizeof(name), "/io_buffer.%ld.%u", (long)getpid(), counter++);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0) shm_unlink(name);
+        else if (errno != EEXIST) break;
+    }
+#endif
+    if (fd < 0) return -1;
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+IO_Err io_buffer_init_mirrored(IO_Buffer *b, size_t cap) {
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) return IO_ERR_UNSUPPORTED;
+
+    size_t size = ((cap + 1) + page - 1) / page * page;
+
+    int fd = _io_shm_create(size);
+    if (fd < 0) return IO_ERR_UNSUPPORTED;
+
+    // NOTE: Reserve the whole address range first, then map the same pages
+    //       into both halves of it.
+    char *base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return IO_ERR_OOM;
+    }
+    void *lo = mmap(base,        size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    void *hi = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    close(fd);
+    if (lo == MAP_FAILED || hi == MAP_FAILED) {
+        munmap(base, 2 * size);
+        return IO_ERR_OOM;
+    }
+
+    b->cap = b->min_cap = b->max_cap = size - 1;
+    b->flags = IO_BUFFER_MIRRORED;
+    b->pool = NULL;
+    _IO_STAT(b->stats = (IO_BufferStats){0});
+    b->end = b->start = b->buf = base;
+    return IO_ERR_OK;
+}
+
+/**
+ * Binds `size` bytes of memory at `addr` to NUMA node `node`.
+ */
+static IO_Err _io_numa_bind(void *addr, size_t size, int node) {
+#if defined(__linux__) && defined(__NR_mbind)
+    // NOTE: mbind() is declared in <numaif.h>, which comes with libnuma, so the
+    //       system call is made directly.
+    enum { MAX_NODES = 1024, MPOL_BIND_ = 2, BITS = 8 * sizeof(unsigned long) };
+    if (node < 0 || node >= MAX_NODES) return IO_ERR_OOB;
+    unsigned long mask[MAX_NODES / BITS] = {0};
+    mask[node / BITS] |= 1UL << (node % BITS);
+    if (syscall(__NR_mbind, addr, size, MPOL_BIND_, mask, (unsigned long)MAX_NODES + 1, 0) != 0) return IO_ERR_UNSUPPORTED;
+    return IO_ERR_OK;
+#else
+    (void)addr; (void)size; (void)node;
+    return IO_ERR_UNSUPPORTED;
+#endif // defined(__linux__) && defined(__NR_mbind)
+}
+
+IO_Err io_buffer_init_opts(IO_Buffer *b, size_t cap, const IO_BufferOpts *opts) {
+    if (opts == NULL || (opts->align == 0 && opts->flags == 0)) return io_buffer_init(b, cap);
+    if ((opts->align & (opts->align - 1)) != 0) return IO_ERR_OOB;
+
+    long page = sysconf(_SC_PAGESIZE);
+    if (page <= 0) return IO_ERR_UNSUPPORTED;
+    size_t align = MAX(opts->align, (size_t)page);
+    if (opts->flags & (IO_BUFFER_OPT_HUGEPAGES | IO_BUFFER_OPT_HUGETLB)) align = MAX(align, (size_t)IO_HUGE_PAGE_SIZE);
+    size_t size = ((cap + 1) + align - 1) / align * align;
+
+    char *base;
+    if (opts->flags & IO_BUFFER_OPT_HUGETLB) {
+#ifdef MAP_HUGETLB
+        // NOTE: Huge page mappings are aligned to the huge page size already.
+        if (align > IO_HUGE_PAGE_SIZE) return IO_ERR_UNSUPPORTED;
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base == MAP_FAILED) return IO_ERR_OOM;
+#else
+        return IO_ERR_UNSUPPORTED;
+#endif // MAP_HUGETLB
+    } else {
+        // NOTE: Map `align` bytes more than needed, then unmap what sticks out
+        //       on both sides of the aligned range.
+        size_t len = size + align - page;
+        char *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) return IO_ERR_OOM;
+        base = (char *)(((uintptr_t)map + align - 1) & ~(uintptr_t)(align - 1));
+        if (base > map) munmap(map, base - map);
+        if (map + len > base + size) munmap(base + size, (map + len) - (base + size));
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (opts->flags & IO_BUFFER_OPT_HUGEPAGES) madvise(base, size, MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+
+    if (opts->flags & IO_BUFFER_OPT_NUMA) {
+        IO_Err err = _io_numa_bind(base, size, opts->numa_node);
+        if (err != IO_ERR_OK) {
+            munmap(base, size);
+            return err;
+        }
+    }
+
+    b->cap = b->min_cap = b->max_cap = size - 1;
+    b->flags = IO_BUFFER_PAGES;
+    b->pool = NULL;
+    _IO_STAT(b->stats = (IO_BufferStats){0});
+    b->end = b->start = b->buf = base;
+    return IO_ERR_OK;
+}
+
+IO_Err io_buffer_free(IO_Buffer *b) {
+    if (b->flags & IO_BUFFER_MIRRORED) {
+        munmap(b->buf, 2 * _io_buffer_size(b));
+    } else if (b->flags & IO_BUFFER_PAGES) {
+        munmap(b->buf, _io_buffer_size(b));
+    } else if (b->flags & IO_BUFFER_MAPPED) {
+        if (b->buf != NULL) munmap(b->buf, b->cap);
+    } else if (b->flags & IO_BUFFER_POOLED) {
+        io_buffer_reset(b);
+        io_buffer_detach(b);
+    } else {
+        IO_FREE(b->buf);
+    }
+    return IO_ERR_OK;
+}
+
+/**
+ * Returns the size of a slab of pool `p`: a header holding the pointer to the
+ * next slab, followed by the blocks.
+ */
+static inline size_t _io_buffer_pool_slab_size(IO_BufferPool *p) {
+    return IO_BUFFER_POOL_ALIGN + p->nblocks * p->block_size;
+}
+
+IO_Err io_buffer_pool_init(IO_BufferPool *p, size_t cap, size_t nblocks) {
+    if (nblocks == 0) return IO_ERR_OOB;
+    p->cap = cap;
+    p->block_size = (cap + 1 + IO_BUFFER_POOL_ALIGN - 1) / IO_BUFFER_POOL_ALIGN * IO_BUFFER_POOL_ALIGN;
+    p->nblocks = nblocks;
+    p->slabs = NULL;
+    p->free_list = NULL;
+    p->nfree = 0;
+    return IO_ERR_OK;
+}
+
+IO_Err io_buffer_pool_free(IO_BufferPool *p) {
+    while (p->slabs != NULL) {
+        char *next = *(char **)p->slabs;
+        munmap(p->slabs, _io_buffer_pool_slab_size(p));
+        p->slabs = next;
+    }
+    p->free_list = NULL;
+    p->nfree = 0;
+    return IO_ERR_OK;
+}
+
+/**
+ * Takes a block out of pool `p`, mapping a new slab if the pool has no free
+ * blocks. Returns NULL if the slab could not be mapped.
+ */
+static char *_io_buffer_pool_get(IO_BufferPool *p) {
+    if (p->free_list == NULL) {
+        char *slab = mmap(NULL, _io_buffer_pool_slab_size(p), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (slab == MAP_FAILED) return NULL;
+        *(char **)slab = p->slabs;
+        p->slabs = slab;
+
+        // NOTE: Thread the blocks in reverse, so they are handed out in
+        //       address order.
+        for (size_t i = p->nblocks; i-- > 0;) {
+            char *block = slab + IO_BUFFER_POOL_ALIGN + i * p->block_size;
+            *(void **)block = p->free_list;
+            p->free_list = block;
+        }
+        p->nfree += p->nblocks;
+    }
+
+    char *block = p->free_list;
+    p->free_list = *(void **)block;
+    p->nfree--;
+    return block;
+}
+
+/**
+ * Gives block `block` back to pool `p`.
+ */
+static void _io_buffer_pool_put(IO_BufferPool *p, char *block) {
+    *(void **)block = p->free_list;
+    p->free_list = block;
+    p->nfree++;
+}
+
+/**
+ * Takes storage for detached pooled IO buffer `b` from its pool.
+ */
+static IO_Err _io_buffer_attach(IO_Buffer *b) {
+    char *block = _io_buffer_pool_get(b->pool);
+    if (block == NULL) return IO_ERR_OOM;
+    b->end = b->start = b->buf = block;
+    return IO_ERR_OK;
+}
+
+IO_Err io_buffer_init_pooled(IO_Buffer *b, IO_BufferPool *p) {
+    b->cap = b->min_cap = b->max_cap = p->cap;
+    b->flags = IO_BUFFER_POOLED;
+    b->pool = p;
+    _IO_STAT(b->stats = (IO_BufferStats){0});
+    return _io_buffer_attach(b);
+}
+
+IO_Err io_buffer_detach(IO_Buffer *b) {
+    if (!(b->flags & IO_BUFFER_POOLED) || b->buf == NULL) return IO_ERR_OK;
+    if (io_buffer_len(b) > 0) return IO_ERR_OK;
+    _io_buffer_pool_put(b->pool, b->buf);
+    b->end = b->start = b->buf = NULL;
+    return IO_ERR_OK;
+}
+
+IO_Err io_buffer_init_growable(IO_Buffer *b, size_t cap, size_t max_cap) {
+    if (cap > max_cap) return IO_ERR_OOB;
+    IO_Err err = io_buffer_init(b, cap);
+    if (err != IO_ERR_OK) return err;
+    b->max_cap = max_cap;
+    b->flags = IO_BUFFER_GROWABLE;
+    return IO_ERR_OK;
+}
+
+/**
+ * Wraps physical offset `pos` back into the storage region of buffer `b`.
+ *
+ * Every offset the buffer computes is a sum of an in-bounds offset and a
+ * length that does not exceed the physical size, so a single conditional
+ * subtraction is enough. This keeps integer division out of per-byte paths
+ * like io_buffer_at().
+ */
+static inline size_t _io_buffer_wrap(IO_Buffer *b, size_t pos) {
+    size_t size = _io_buffer_size(b);
+    return (pos >= size) ? pos - size : pos;
+}
+
+size_t io_buffer_len(IO_Buffer *b) {
+    if (b->end >= b->start) return b->end - b->start;
+    return _io_buffer_size(b) - (b->start - b->buf) + (b->end - b->buf);
+}
+
+IO_Err io_buffer_reset(IO_Buffer *b) {
+    b->start = b->end;
+    return IO_ERR_OK;
+}
+
+/**
+ * Returns the number of bytes between the later (farthest-from-`buf`) of
+ * `b->start` and `b->end` and the physical end of the storage region.
+ *
+ * This is the length of the contiguous region available (or occupied) from
+ * that pointer to the buffer's end; use it to determine how many bytes can be
+ * read or written without wrapping back to `b->buf`.
+ *
+ * Example (8 bytes total, indices 0..7):
+ *   case A: end >= start
+ *     buf: |a|b|c|d|e|f|g|h|
+ *             ^         ^
+ *             start     end
+ *     return value: distance from `end` to buffer end (1)
+ *
+ *   case B: end < start
+ *     buf: |a|b|c|d|e|f|g|h|
+ *             ^       ^
+ *             end     start
+ *     return value: distance from `start` to buffer end (2)
+ */
+static inline size_t _io_buffer_left_until_wrap(IO_Buffer *b) {
+    if (b->end >= b->start) return _io_buffer_size(b) - (b->end - b->buf);
+    return _io_buffer_size(b) - (b->start - b->buf);
+}
+
+/**
+ * Returns the number of free bytes that can be written starting at `b->end`
+ * without wrapping back to `b->buf`.
+ */
+static inline size_t _io_buffer_free_until_wrap(IO_Buffer *b) {
+    size_t space_left = b->cap - io_buffer_len(b);
+    if (b->flags & IO_BUFFER_MIRRORED) return space_left;
+    if (b->end >= b->start) return MIN(_io_buffer_size(b) - (b->end - b->buf), space_left);
+    return space_left;
+}
+
+#ifdef IO_STATS
+/**
+ * Updates the occupancy counters of IO buffer `b` for `n` bytes that are
+ * about to be added at `b->end` (the caller has made sure they fit).
+ */
+static inline void _io_buffer_stat_add(IO_Buffer *b, size_t n) {
+    if ((size_t)(b->end - b->buf) + n >= _io_buffer_size(b)) b->stats.nwraps++;
+    size_t len = io_buffer_len(b) + n;
+    if (len > b->stats.peak) b->stats.peak = len;
+}
+#endif // IO_STATS
+
+/**
+ * Marks `n` bytes written directly at `b->end` as valid data.
+ *
+ * NOTE: The function does not perform bounds checking. The caller must make
+ *       sure that `n` does not exceed the free space of the buffer.
+ */
+static inline void _io_buffer_commit(IO_Buffer *b, size_t n) {
+    _IO_STAT(_io_buffer_stat_add(b, n));
+    b->end = b->buf + _io_buffer_wrap(b, (b->end - b->buf) + n);
+    IO_ASSERT(b->end <= b->buf + b->cap && "Out of bounds");
+}
+
+/**
+ * Reallocates the storage of growable IO buffer `b` to `cap` capacity, which
+ * must be enough to hold the buffered data.
+ *
+ * If the data wraps around, the part at the beginning of the storage is
+ * copied right after the old end when it fits there, which linearizes the
+ * data. Otherwise the part at the end of the storage is moved to the end of
+ * the new one.
+ */
+static IO_Err _io_buffer_resize(IO_Buffer *b, size_t cap) {
+    size_t old_size = _io_buffer_size(b);
+    size_t len = io_buffer_len(b);
+    size_t start = b->start - b->buf, end = b->end - b->buf;
+    IO_ASSERT(len <= cap && "Out of bounds");
+
+    if (len == 0) start = end = 0;
+    if (cap + 1 < old_size && end < start) {
+        memmove(b->buf + cap + 1 - (old_size - start), b->buf + start, old_size - start);
+        start = cap + 1 - (old_size - start);
+    } else if (cap + 1 < old_size && len > 0) {
+        memmove(b->buf, b->buf + start, len);
+        start = 0;
+        end = len;
+    }
+
+    char *buf = IO_REALLOC(b->buf, cap + 1);
+    if (buf == NULL) return IO_ERR_OOM;
+    b->buf = buf;
+    b->cap = cap;
+
+    size_t size = cap + 1;
+    if (size > old_size && end < start && end <= size - old_size) {
+        memcpy(buf + old_size, buf, end);
+        end = _io_buffer_wrap(b, old_size + end);
+    } else if (size > old_size && end < start) {
+        memmove(buf + size - (old_size - start), buf + start, old_size - start);
+        start = size - (old_size - start);
+    }
+    b->start = buf + start;
+    b->end = buf + end;
+    return IO_ERR_OK;
+}
+
+IO_Err io_buffer_reserve(IO_Buffer *b, size_t n) {
+    if (b->buf == NULL && (b->flags & IO_BUFFER_POOLED)) {
+        IO_Err err = _io_buffer_attach(b);
+        if (err != IO_ERR_OK) return err;
+    }
+
+    size_t len = io_buffer_len(b);
+    if (n <= b->cap - len) return IO_ERR_OK;
+    if (!(b->flags & IO_BUFFER_GROWABLE) || n > b->max_cap - len) return IO_ERR_OOB;
+
+    size_t cap = MAX(b->cap, 1);
+    while (cap < len + n) cap = (cap > b->max_cap / 2) ? b->max_cap : cap * 2;
+    return _io_buffer_resize(b, cap);
+}
+
+IO_Err io_buffer_shrink(IO_Buffer *b) {
+    if (!(b->flags & IO_BUFFER_GROWABLE) || b->cap == b->min_cap) return IO_ERR_OK;
+    if (io_buffer_len(b) > 0) return IO_ERR_OK;
+    return _io_buffer_resize(b, b->min_cap);
+}
+
+size_t io_buffer_nadvance(IO_Buffer *b, size_t n) {
+    size_t len = io_buffer_len(b);
+    size_t to_shift = (n > len) ? len : n;
+
+    size_t cur_pos = b->start - b->buf;
+    size_t new_pos = _io_buffer_wrap(b, cur_pos + to_shift);
+
+    b->start = b->buf + new_pos;
+    IO_ASSERT(b->start <= b->buf + b->cap && "Out of bounds");
+
+    return to_shift;
+}
+
+char io_buffer_at(IO_Buffer *b, size_t pos) {
+    size_t cur_pos = b->start - b->buf;
+    return b->buf[_io_buffer_wrap(b, cur_pos + pos)];
+}
+
+IO_Err io_buffer_nspit(IO_Buffer *src, char *dest, size_t n) {
+    if (n == 0 || dest == NULL) return IO_ERR_OK;
+    if (n > io_buffer_len(src)) return IO_ERR_OOB;
+    _IO_STAT(src->stats.ncopied += n);
+
+    if (src->end >= src->start || (src->flags & IO_BUFFER_MIRRORED)) {
+        memcpy(dest, src->start, n);
+        return IO_ERR_OK;
+    }
+
+    size_t to_copy = MIN(_io_buffer_left_until_wrap(src), n);
+    memcpy(dest, src->start, to_copy);
+    if (n > to_copy) {
+        memcpy(dest + to_copy, src->buf, n-to_copy);
+    }
+
+    return IO_ERR_OK;
+}
+
+IO_Err io_buffer_append(IO_Buffer *dest, char *src, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+    if (dest->flags & IO_BUFFER_MAPPED) return IO_ERR_OOB;
+
+    IO_Err err = io_buffer_reserve(dest, n);
+    if (err != IO_ERR_OK) return err;
+    _IO_STAT(dest->stats.ncopied += n);
+
+    if (dest->flags & IO_BUFFER_MIRRORED) {
+        memcpy(dest->end, src, n);
+        _io_buffer_commit(dest, n);
+        return IO_ERR_OK;
+    }
+
+    _IO_STAT(_io_buffer_stat_add(dest, n));
+    if (dest->start > dest->end) {
+        memcpy(dest->end, src, n);
+        dest->end += n;
+        return IO_ERR_OK;
+    }
+
+    size_t to_copy = MIN(_io_buffer_left_until_wrap(dest), n);
+    memcpy(dest->end, src, to_copy);
+    dest->end += to_copy;
+    if (dest->end == dest->buf + _io_buffer_size(dest)) dest->end = dest->buf;
+    n -= to_copy;
+
+    if (n > 0) {
+        memcpy(dest->end, src + to_copy, n);
+        dest->end += n;
+    }
+
+    IO_ASSERT(dest->end <= dest->buf + _io_buffer_size(dest) && "Out of bounds");
+
+    return IO_ERR_OK;
+}
+
+size_t io_buffer_peek_spans(IO_Buffer *b, IO_Span spans[2]) {
+    size_t len = io_buffer_len(b);
+    if (len == 0) return 0;
+
+    if (b->end >= b->start || (b->flags & IO_BUFFER_MIRRORED)) {
+        spans[0] = (IO_Span){.ptr = b->start, .len = len};
+        return 1;
+    }
+
+    size_t first = _io_buffer_left_until_wrap(b);
+    spans[0] = (IO_Span){.ptr = b->start, .len = first};
+    spans[1] = (IO_Span){.ptr = b->buf,   .len = len - first};
+    return 2;
+}
+
+size_t io_buffer_reserve_spans(IO_Buffer *b, IO_Span spans[2]) {
+    if (b->flags & IO_BUFFER_MAPPED) return 0;
+    if (b->buf == NULL && io_buffer_reserve(b, 0) != IO_ERR_OK) return 0;
+
+    size_t len = io_buffer_len(b);
+    if (len == 0) b->start = b->end = b->buf;
+
+    size_t space_left = b->cap - len;
+    if (space_left == 0) return 0;
+
+    size_t first = _io_buffer_free_until_wrap(b);
+    spans[0] = (IO_Span){.ptr = b->end, .len = first};
+    if (first == space_left) return 1;
+
+    spans[1] = (IO_Span){.ptr = b->buf, .len = space_left - first};
+    return 2;
+}
+
+IO_Err io_buffer_commit(IO_Buffer *b, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+    if (n > b->cap - io_buffer_len(b) || (b->flags & IO_BUFFER_MAPPED)) return IO_ERR_OOB;
+    _io_buffer_commit(b, n);
+    return IO_ERR_OK;
+}
+
+/**
+ * Maximum size of the set for which an SIMD kernel is used by
+ * io_buffer_find_any(). Larger sets use a lookup table.
+ */
+#define _IO_FIND_ANY_SIMD_MAX 4
+
+#ifdef IO_SIMD_FIND_ANY
+/**
+ * Returns the mask of the bytes of a vector `chunk` that are equal to any of
+ * the `nset` bytes in `set`.
+ */
+#  ifdef __AVX2__
+#    define _IO_VEC_SIZE 32
+static inline unsigned _io_vec_match(const char *p, const char *set, size_t nset) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hit = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(set[0]));
+    for (size_t i = 1; i < nset; i++) {
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(set[i])));
+    }
+    return (unsigned)_mm256_movemask_epi8(hit);
+}
+#  else // __AVX2__
+#    define _IO_VEC_SIZE 16
+static inline unsigned _io_vec_match(const char *p, const char *set, size_t nset) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+    __m128i hit = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(set[0]));
+    for (size_t i = 1; i < nset; i++) {
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(set[i])));
+    }
+    return (unsigned)_mm_movemask_epi8(hit);
+}
+#  endif // __AVX2__
+#endif // IO_SIMD_FIND_ANY
+
+/**
+ * Returns pointer to the first byte of contiguous region `[p, p + len)` that
+ * is equal to any of the `nset` bytes in `set`, or NULL. `table` marks the
+ * bytes of `set` (built once by io_buffer_find_any() for all regions).
+ */
+static const char *_io_mem_find_any(const char *p, size_t len, const char *set, size_t nset,
+                                    const bool table[256]) {
+    if (nset == 1) return memchr(p, set[0], len);
+
+    size_t i = 0;
+#ifdef IO_SIMD_FIND_ANY
+    if (nset <= _IO_FIND_ANY_SIMD_MAX) {
+        for (; i + _IO_VEC_SIZE <= len; i += _IO_VEC_SIZE) {
+            unsigned mask = _io_vec_match(p + i, set, nset);
+            if (mask != 0) return p + i + __builtin_ctz(mask);
+        }
+    }
+#endif // IO_SIMD_FIND_ANY
+
+    for (; i < len; i++) {
+        if (table[(unsigned char)p[i]]) return p + i;
+    }
+    return NULL;
+}
+
+size_t io_buffer_find_any(IO_Buffer *b, size_t from, const char *set, size_t nset) {
+    if (nset == 0) return IO_NOT_FOUND;
+
+    bool table[256] = {0};
+    if (nset > 1) {
+        for (size_t j = 0; j < nset; j++) table[(unsigned char)set[j]] = true;
+    }
+
+    IO_Span spans[2];
+    size_t nspans = io_buffer_peek_spans(b, spans);
+    size_t base = 0;
+    for (size_t i = 0; i < nspans; i++) {
+        if (from < base + spans[i].len) {
+            size_t skip = (from > base) ? from - base : 0;
+            const char *found = _io_mem_find_any(spans[i].ptr + skip, spans[i].len - skip, set, nset, table);
+            if (found != NULL) return base + (found - spans[i].ptr);
+        }
+        base += spans[i].len;
+    }
+    return IO_NOT_FOUND;
+}
+
+size_t io_buffer_find_byte(IO_Buffer *b, size_t from, char c) {
+    return io_buffer_find_any(b, from, &c, 1);
+}
+
+/**
+ * Compares `n` bytes of IO buffer `b` starting at logical position `pos` with
+ * `s`. Returns true if they are equal.
+ *
+ * NOTE: The function does not perform bounds checking.
+ */
+static bool _io_buffer_equals(IO_Buffer *b, size_t pos, const char *s, size_t n) {
+    size_t phys = _io_buffer_wrap(b, (b->start - b->buf) + pos);
+    size_t first = MIN(n, _io_buffer_size(b) - phys);
+    if (memcmp(b->buf + phys, s, first) != 0) return false;
+    return memcmp(b->buf, s + first, n - first) == 0;
+}
+
+size_t io_buffer_find(IO_Buffer *b, size_t from, const char *needle, size_t n) {
+    if (n == 0) return IO_NOT_FOUND;
+
+    size_t len = io_buffer_len(b);
+    size_t pos = from;
+    while ((pos = io_buffer_find_byte(b, pos, needle[0])) != IO_NOT_FOUND) {
+        if (pos + n > len) return IO_NOT_FOUND;
+        if (n == 1 || _io_buffer_equals(b, pos + 1, needle + 1, n - 1)) return pos;
+        pos++;
+    }
+    return IO_NOT_FOUND;
+}
+
+#ifndef __STDC_NO_ATOMICS__
+IO_Err io_spsc_init(IO_SpscBuffer *q, size_t cap) {
+    q->cap = cap;
+    q->buf = IO_MALLOC(cap + 1);
+    if (q->buf == NULL) return IO_ERR_OOM;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->head_cached = q->tail_cached = 0;
+    return IO_ERR_OK;
+}
+
+IO_Err io_spsc_free(IO_SpscBuffer *q) {
+    IO_FREE(q->buf);
+    return IO_ERR_OK;
+}
+
+/**
+ * Returns the number of bytes between offsets `from` and `to` of SPSC buffer
+ * `q`, going forward and wrapping around.
+ */
+static inline size_t _io_spsc_distance(IO_SpscBuffer *q, size_t from, size_t to) {
+    return (to >= from) ? to - from : (q->cap + 1) - from + to;
+}
+
+static inline size_t _io_spsc_wrap(IO_SpscBuffer *q, size_t pos) {
+    return (pos >= q->cap + 1) ? pos - (q->cap + 1) : pos;
+}
+
+/**
+ * Producer: returns the free space of SPSC buffer `q`, loading the consumer's
+ * position only if the cached one shows less than `need` bytes.
+ */
+static inline size_t _io_spsc_space(IO_SpscBuffer *q, size_t need) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    size_t space = q->cap - _io_spsc_distance(q, q->head_cached, tail);
+    if (space >= need) return space;
+    q->head_cached = atomic_load_explicit(&q->head, memory_order_acquire);
+    return q->cap - _io_spsc_distance(q, q->head_cached, tail);
+}
+
+/**
+ * Consumer: returns the data length of SPSC buffer `q`, loading the
+ * producer's position only if the cached one shows less than `need` bytes.
+ */
+static inline size_t _io_spsc_avail(IO_SpscBuffer *q, size_t need) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    size_t avail = _io_spsc_distance(q, head, q->tail_cached);
+    if (avail >= need) return avail;
+    q->tail_cached = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return _io_spsc_distance(q, head, q->tail_cached);
+}
+
+/**
+ * Fills `spans` with up to two regions that make up `n` bytes of SPSC buffer
+ * `q` starting at offset `pos`, and returns the number of regions filled.
+ */
+static inline size_t _io_spsc_spans(IO_SpscBuffer *q, size_t pos, size_t n, IO_Span spans[2]) {
+    if (n == 0) return 0;
+    size_t first = MIN(n, (q->cap + 1) - pos);
+    spans[0] = (IO_Span){.ptr = q->buf + pos, .len = first};
+    if (first == n) return 1;
+    spans[1] = (IO_Span){.ptr = q->buf, .len = n - first};
+    return 2;
+}
+
+size_t io_spsc_reserve_spans(IO_SpscBuffer *q, IO_Span spans[2]) {
+    size_t space = _io_spsc_space(q, SIZE_MAX);
+    return _io_spsc_spans(q, atomic_load_explicit(&q->tail, memory_order_relaxed), space, spans);
+}
+
+IO_Err io_spsc_publish(IO_SpscBuffer *q, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+    if (n > _io_spsc_space(q, n)) return IO_ERR_OOB;
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, _io_spsc_wrap(q, tail + n), memory_order_release);
+    return IO_ERR_OK;
+}
+
+IO_Err io_spsc_append(IO_SpscBuffer *q, const char *src, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+    if (n > _io_spsc_space(q, n)) return IO_ERR_OOB;
+
+    IO_Span spans[2];
+    size_t nspans = _io_spsc_spans(q, atomic_load_explicit(&q->tail, memory_order_relaxed), n, spans);
+    for (size_t i = 0; i < nspans; i++) {
+        memcpy(spans[i].ptr, src, spans[i].len);
+        src += spans[i].len;
+    }
+    return io_spsc_publish(q, n);
+}
+
+size_t io_spsc_len(IO_SpscBuffer *q) {
+    return _io_spsc_avail(q, SIZE_MAX);
+}
+
+size_t io_spsc_peek_spans(IO_SpscBuffer *q, IO_Span spans[2]) {
+    size_t avail = _io_spsc_avail(q, SIZE_MAX);
+    return _io_spsc_spans(q, atomic_load_explicit(&q->head, memory_order_relaxed), avail, spans);
+}
+
+IO_Err io_spsc_nspit(IO_SpscBuffer *q, char *dest, size_t n) {
+    if (n == 0 || dest == NULL) return IO_ERR_OK;
+    if (n > _io_spsc_avail(q, n)) return IO_ERR_OOB;
+
+    IO_Span spans[2];
+    size_t nspans = _io_spsc_spans(q, atomic_load_explicit(&q->head, memory_order_relaxed), n, spans);
+    for (size_t i = 0; i < nspans; i++) {
+        memcpy(dest, spans[i].ptr, spans[i].len);
+        dest += spans[i].len;
+    }
+    return IO_ERR_OK;
+}
+
+size_t io_spsc_nadvance(IO_SpscBuffer *q, size_t n) {
+    size_t to_shift = MIN(n, _io_spsc_avail(q, n));
+    if (to_shift == 0) return 0;
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, _io_spsc_wrap(q, head + to_shift), memory_order_release);
+    return to_shift;
+}
+
+/**
+ * Returns the index of the bucket of an `IO_Histogram` that counts value `v`.
+ */
+static inline size_t _io_histogram_bucket(uint64_t v) {
+    if (v < (1u << IO_HISTOGRAM_SUB_BITS)) return v;
+    unsigned shift = 63 - __builtin_clzll(v) - IO_HISTOGRAM_SUB_BITS;
+    size_t sub = (v >> shift) & ((1u << IO_HISTOGRAM_SUB_BITS) - 1);
+    return ((size_t)(shift + 1) << IO_HISTOGRAM_SUB_BITS) + sub;
+}
+
+/**
+ * Returns the highest value counted by bucket `i` of an `IO_Histogram`.
+ */
+static inline uint64_t _io_histogram_bucket_max(size_t i) {
+    if (i < (1u << IO_HISTOGRAM_SUB_BITS)) return i;
+    unsigned shift = (i >> IO_HISTOGRAM_SUB_BITS) - 1;
+    uint64_t sub = i & ((1u << IO_HISTOGRAM_SUB_BITS) - 1);
+    uint64_t lo = ((1ull << IO_HISTOGRAM_SUB_BITS) | sub) << shift;
+    return lo + ((1ull << shift) - 1);
+}
+
+IO_Err io_histogram_reset(IO_Histogram *h) {
+    atomic_store_explicit(&h->count, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->sum, 0, memory_order_relaxed);
+    atomic_store_explicit(&h->max, 0, memory_order_relaxed);
+    for (size_t i = 0; i < IO_HISTOGRAM_BUCKETS; i++) {
+        atomic_store_explicit(&h->buckets[i], 0, memory_order_relaxed);
+    }
+    return IO_ERR_OK;
+}
+
+void io_histogram_record(IO_Histogram *h, uint64_t v) {
+    atomic_fetch_add_explicit(&h->buckets[_io_histogram_bucket(v)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, v, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (v > max && !atomic_compare_exchange_weak_explicit(&h->max, &max, v, memory_order_relaxed, memory_order_relaxed));
+}
+
+uint64_t io_histogram_percentile(IO_Histogram *h, double p) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < IO_HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (seen >= rank) return MIN(_io_histogram_bucket_max(i), max);
+    }
+    // NOTE: A value being recorded concurrently may already be counted in
+    //       `count`, but not in its bucket yet.
+    return max;
+}
+
+IO_Err io_histogram_dump(IO_Histogram *h, const char *name, int fd) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    uint64_t sum = atomic_load_explicit(&h->sum, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    int n = dprintf(fd, "%s count=%" PRIu64 " mean=%" PRIu64 " p50=%" PRIu64 " p99=%" PRIu64 " p999=%" PRIu64 " max=%" PRIu64 "\n",
+                    name, count, (count > 0) ? sum / count : 0,
+                    io_histogram_percentile(h, 50.0), io_histogram_percentile(h, 99.0),
+                    io_histogram_percentile(h, 99.9), max);
+    if (n < 0) return IO_ERR_FAILED_WRITE;
+    return IO_ERR_OK;
+}
+
+#ifdef IO_TRACE
+static inline uint64_t _io_trace_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * Records the duration of event `ev` of reader (`r`) that started at `start`
+ * into the histogram attached to the reader, if any.
+ */
+static inline void _io_trace_record(IO_Reader *r, IO_TraceEvent ev, uint64_t start) {
+    IO_Histogram *h = r->trace[ev];
+    if (h != NULL) io_histogram_record(h, IO_TRACE_CLOCK() - start);
+}
+#endif // IO_TRACE
+#endif // __STDC_NO_ATOMICS__
+
+IO_Err io_reader_init(IO_Reader *r, IO_Buffer *b, int fd) {
+    r->b = b;
+    r->fd = fd;
+    r->pos = r->nread = 0;
+    r->src = (IO_Source){0};
+    r->ra_min = r->ra_max = r->ra_cur = 0;
+    _IO_STAT(r->stats = (IO_ReaderStats){0});
+#ifdef IO_TRACE
+    for (int i = 0; i < IO_TRACE_COUNT; i++) r->trace[i] = NULL;
+#endif // IO_TRACE
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_set_readahead(IO_Reader *r, size_t min, size_t max) {
+    if (min > max) return IO_ERR_OOB;
+    r->ra_min = min;
+    r->ra_max = max;
+    r->ra_cur = min;
+    return IO_ERR_OK;
+}
+
+/**
+ * Returns how many bytes reader (`r`) should request from its file
+ * descriptor when the caller needs `n` of them and `avail` bytes are free.
+ */
+static inline size_t _io_reader_readahead(IO_Reader *r, size_t n, size_t avail) {
+    return MIN(MAX(n, r->ra_cur), avail);
+}
+
+/**
+ * Adapts the read-ahead size of reader (`r`) to the outcome of a read of
+ * `want` bytes that returned `nread`.
+ */
+static inline void _io_reader_adapt(IO_Reader *r, size_t want, ssize_t nread) {
+    if (r->ra_max == 0) return;
+    if (nread >= 0 && (size_t)nread == want) {
+        r->ra_cur = MIN(MAX(r->ra_cur, 1) * 2, r->ra_max);
+    } else if (nread < 0 || (size_t)nread < want / 4) {
+        r->ra_cur = MAX(r->ra_cur / 2, r->ra_min);
+    }
+}
+
+IO_Err io_reader_stats(IO_Reader *r, IO_ReaderStats *stats) {
+#ifdef IO_STATS
+    *stats = r->stats;
+    stats->b = r->b->stats;
+    return IO_ERR_OK;
+#else // IO_STATS
+    (void)r;
+    *stats = (IO_ReaderStats){0};
+    return IO_ERR_UNSUPPORTED;
+#endif // IO_STATS
+}
+
+IO_Err io_reader_stats_reset(IO_Reader *r) {
+#ifdef IO_STATS
+    r->stats = (IO_ReaderStats){0};
+    r->b->stats = (IO_BufferStats){.peak = io_buffer_len(r->b)};
+    return IO_ERR_OK;
+#else // IO_STATS
+    (void)r;
+    return IO_ERR_UNSUPPORTED;
+#endif // IO_STATS
+}
+
+#ifndef __STDC_NO_ATOMICS__
+IO_Err io_reader_trace(IO_Reader *r, IO_TraceEvent ev, IO_Histogram *h) {
+#ifdef IO_TRACE
+    if (ev < 0 || ev >= IO_TRACE_COUNT) return IO_ERR_OOB;
+    r->trace[ev] = h;
+    return IO_ERR_OK;
+#else // IO_TRACE
+    (void)r; (void)ev; (void)h;
+    return IO_ERR_UNSUPPORTED;
+#endif // IO_TRACE
+}
+#endif // __STDC_NO_ATOMICS__
+
+IO_Err io_reader_init_source(IO_Reader *r, IO_Buffer *b, const IO_Source *src) {
+    if (src->read == NULL) return IO_ERR_UNSUPPORTED;
+    io_reader_init(r, b, -1);
+    r->src = *src;
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_init_mmap(IO_Reader *r, IO_Buffer *b, int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return IO_ERR_UNSUPPORTED;
+
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || offset > st.st_size) offset = 0;
+
+    size_t size = st.st_size;
+    char *map = NULL;
+    if (size > 0) {
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) return IO_ERR_OOM;
+        madvise(map, size, MADV_SEQUENTIAL);
+    }
+
+    b->cap = b->min_cap = b->max_cap = size;
+    b->flags = IO_BUFFER_MAPPED;
+    b->pool = NULL;
+    b->buf = map;
+    b->start = map + offset;
+    b->end = map + size;
+    _IO_STAT(b->stats = (IO_BufferStats){.peak = size - offset});
+
+    io_reader_init(r, b, fd);
+    r->nread = size - offset;
+    return IO_ERR_OK;
+}
+
+#ifdef IO_STATS
+/**
+ * Accounts a read of reader (`r`) that asked for `n` bytes and returned
+ * `nread` (see `IO_ReaderStats`).
+ */
+static inline void _io_reader_stat_read(IO_Reader *r, size_t n, ssize_t nread) {
+    r->stats.nreads++;
+    if (nread > 0) {
+        r->stats.nbytes += nread;
+        if ((size_t)nread < n) r->stats.nshort++;
+    } else if (nread == 0) {
+        r->stats.neof++;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        r->stats.nagain++;
+    }
+}
+#endif // IO_STATS
+
+/**
+ * Reads up to `n` bytes into `buf` from the reader's (`r`) source, or from
+ * its file descriptor if there is no custom source.
+ *
+ * Memory mapped readers have nothing left to read: they report end of file.
+ */
+static inline ssize_t _io_reader_read(IO_Reader *r, char *buf, size_t n) {
+    if (r->b->flags & IO_BUFFER_MAPPED) return 0;
+
+    ssize_t nread;
+    IO_TRACE_BEGIN(r, IO_TRACE_READ);
+    if (r->src.read == NULL) {
+        nread = _io_read(r->fd, buf, n);
+    } else {
+        do nread = r->src.read(r->src.ctx, buf, n); while (nread < 0 && errno == EINTR);
+    }
+    IO_TRACE_END(r, IO_TRACE_READ, nread);
+    _IO_STAT(_io_reader_stat_read(r, n, nread));
+    return nread;
+}
+
+/**
+ * Same as _io_reader_read(), but reads into `cnt` (at most `IO_READV_MAX`)
+ * regions described by `spans` at once. Sources without `readv` only fill the
+ * first region.
+ */
+static inline ssize_t _io_reader_readv(IO_Reader *r, const IO_Span *spans, int cnt) {
+    if (r->b->flags & IO_BUFFER_MAPPED) return 0;
+    if (r->src.read != NULL && r->src.readv == NULL) return _io_reader_read(r, spans[0].ptr, spans[0].len);
+
+    ssize_t nread;
+    IO_TRACE_BEGIN(r, IO_TRACE_READ);
+    if (r->src.read == NULL) {
+        IO_ASSERT(cnt <= IO_READV_MAX && "Out of bounds");
+        struct iovec iov[IO_READV_MAX];
+        for (int i = 0; i < cnt; i++) {
+            iov[i] = (struct iovec){.iov_base = spans[i].ptr, .iov_len = spans[i].len};
+        }
+        nread = _io_readv(r->fd, iov, cnt);
+    } else {
+        do nread = r->src.readv(r->src.ctx, spans, cnt); while (nread < 0 && errno == EINTR);
+    }
+    IO_TRACE_END(r, IO_TRACE_READ, nread);
+#ifdef IO_STATS
+    size_t n = 0;
+    for (int i = 0; i < cnt; i++) n += spans[i].len;
+    _io_reader_stat_read(r, n, nread);
+#endif // IO_STATS
+    return nread;
+}
+
+/**
+ * Copies `n` buffered bytes of reader (`r`) into `dest` (see
+ * io_buffer_nspit()).
+ */
+static inline IO_Err _io_reader_copy_out(IO_Reader *r, char *dest, size_t n) {
+    IO_TRACE_BEGIN(r, IO_TRACE_COPY);
+    IO_Err err = io_buffer_nspit(r->b, dest, n);
+    IO_TRACE_END(r, IO_TRACE_COPY, n);
+    return err;
+}
+
+/**
+ * Appends `n` bytes from `src` to the internal buffer of reader (`r`) (see
+ * io_buffer_append()).
+ */
+static inline IO_Err _io_reader_copy_in(IO_Reader *r, char *src, size_t n) {
+    IO_TRACE_BEGIN(r, IO_TRACE_COPY);
+    IO_Err err = io_buffer_append(r->b, src, n);
+    IO_TRACE_END(r, IO_TRACE_COPY, n);
+    return err;
+}
+
+size_t io_reader_buffered(IO_Reader *r) {
+    IO_ASSERT(r->nread >= r->pos && r->nread - r->pos == io_buffer_len(r->b) && "Out of bounds");
+    return r->nread - r->pos;
+}
+
+/**
+ * Makes sure the internal buffer of reader (`r`) can hold `n` bytes in total,
+ * growing it if it is growable. Returns `IO_ERR_OOB` if it can not.
+ */
+static inline IO_Err _io_reader_window(IO_Reader *r, size_t n) {
+    if (n <= r->b->cap) return IO_ERR_OK;
+    return io_buffer_reserve(r->b, n - io_buffer_len(r->b));
+}
+
+IO_Err io_reader_npeek(IO_Reader *r, char *dest, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+    IO_Err err = _io_reader_window(r, n);
+    if (err != IO_ERR_OK) return err;
+
+    size_t buffered = io_reader_buffered(r);
+    if (buffered == 0 && r->ra_max > 0) {
+        err = io_reader_fill(r, n);
+        if (err != IO_ERR_OK && err != IO_ERR_PARTIAL) return err;
+        buffered = io_reader_buffered(r);
+    } else if (buffered == 0) {
+        ssize_t nread = _io_reader_read(r, dest, n);
+        if (nread < 0) return _io_read_err();
+        if (nread == 0) return IO_ERR_EOF;
+        IO_ASSERT(_io_reader_copy_in(r, dest, nread) == IO_ERR_OK);
+        r->nread += nread;
+        if ((size_t)nread < n) return IO_ERR_PARTIAL;
+        return IO_ERR_OK;
+    }
+
+    size_t to_copy = MIN(buffered, n);
+    IO_ASSERT(_io_reader_copy_out(r, dest, to_copy) == IO_ERR_OK);
+    if (to_copy < n) return IO_ERR_PARTIAL;
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_fill(IO_Reader *r, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+
+    IO_Buffer *b = r->b;
+    if (b->flags & IO_BUFFER_MAPPED) return IO_ERR_EOF;
+    IO_Err err = io_buffer_reserve(b, n);
+    if (err != IO_ERR_OK) return err;
+
+    IO_Span spans[2];
+    io_buffer_reserve_spans(b, spans);
+    size_t want = _io_reader_readahead(r, n, b->cap - io_buffer_len(b));
+
+    // NOTE: When the free space wraps past the end of the storage, both free
+    //       segments are filled with a single vectored read.
+    ssize_t nread;
+    if (spans[0].len < want) {
+        spans[1].len = want - spans[0].len;
+        nread = _io_reader_readv(r, spans, 2);
+    } else {
+        nread = _io_reader_read(r, spans[0].ptr, want);
+    }
+    _io_reader_adapt(r, want, nread);
+    if (nread < 0) return _io_read_err();
+    if (nread == 0) return IO_ERR_EOF;
+
+    _io_buffer_commit(b, nread);
+    r->nread += nread;
+
+    if ((size_t)nread < n) return IO_ERR_PARTIAL;
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_commit(IO_Reader *r, size_t n) {
+    IO_Err err = io_buffer_commit(r->b, n);
+    if (err != IO_ERR_OK) return err;
+    r->nread += n;
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_prefetch(IO_Reader *r, size_t n) {
+    IO_Err err = _io_reader_window(r, n);
+    if (err != IO_ERR_OK) return err;
+
+    size_t buffered = io_reader_buffered(r);
+    if (buffered >= n) return IO_ERR_OK;
+
+    err = io_reader_fill(r, n - buffered);
+    if (err == IO_ERR_EOF && buffered > 0) return IO_ERR_PARTIAL;
+    return err;
+}
+
+IO_Err io_reader_prefetch_all(IO_Reader *r, size_t n) {
+    IO_Err err = _io_reader_window(r, n);
+    if (err != IO_ERR_OK) return err;
+
+    size_t buffered;
+    while ((buffered = io_reader_buffered(r)) < n) {
+        err = io_reader_fill(r, n - buffered);
+        if (err == IO_ERR_OK || err == IO_ERR_PARTIAL) continue;
+        if (err == IO_ERR_EOF && buffered > 0) return IO_ERR_PARTIAL;
+        return err;
+    }
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_nconsume(IO_Reader *r, char *dest, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+
+    size_t to_copy = MIN(n, io_buffer_len(r->b));
+    if (dest != NULL && to_copy > 0) IO_ASSERT(_io_reader_copy_out(r, dest, to_copy) == IO_ERR_OK);
+    io_buffer_nadvance(r->b, to_copy);
+    r->pos += to_copy;
+
+    IO_ASSERT(r->pos <= r->nread && "Out of bounds");
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_discard(IO_Reader *r) {
+    r->pos += io_buffer_len(r->b);
+    io_buffer_reset(r->b);
+
+    IO_ASSERT(r->pos == r->nread && "Out of bounds");
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_nread(IO_Reader *r, char *dest, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+
+    size_t start_pos = r->pos;
+    IO_ASSERT(io_reader_nconsume(r, dest, n) == IO_ERR_OK);
+    size_t copied = r->pos - start_pos;
+
+    size_t to_read = n - copied;
+    if (to_read > 0 && to_read < r->b->cap && r->ra_max > 0) {
+        IO_Err err = io_reader_fill(r, to_read);
+        if (err == IO_ERR_AGAIN && copied > 0) return IO_ERR_PARTIAL;
+        if (err == IO_ERR_EOF && copied > 0) return IO_ERR_PARTIAL;
+        if (err != IO_ERR_OK && err != IO_ERR_PARTIAL) return err;
+        IO_ASSERT(io_reader_nconsume(r, dest + copied, to_read) == IO_ERR_OK);
+    } else if (to_read > 0) {
+        ssize_t nread = _io_reader_read(r, dest + copied, to_read);
+        if (nread < 0 && copied > 0 && _io_read_err() == IO_ERR_AGAIN) return IO_ERR_PARTIAL;
+        if (nread < 0) return _io_read_err();
+        if (nread == 0 && copied == 0) return IO_ERR_EOF;
+
+        r->pos += nread;
+        r->nread += nread;
+    }
+    
+    IO_ASSERT(r->pos <= r->nread && "Out of bounds");
+    if (start_pos + n > r->pos) return IO_ERR_PARTIAL;
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_nread_full(IO_Reader *r, char *dest, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+
+    size_t start_pos = r->pos;
+    IO_ASSERT(io_reader_nconsume(r, dest, n) == IO_ERR_OK);
+    size_t copied = r->pos - start_pos;
+
+    // NOTE: Once the buffer is drained, it is empty and io_buffer_reserve_spans()
+    //       rewinds it, so each read targets the rest of `dest` followed by a
+    //       single free region of the buffer for read-ahead.
+    while (copied < n) {
+        IO_Span spans[3] = {{.ptr = dest + copied, .len = n - copied}};
+        size_t nspans = 1 + io_buffer_reserve_spans(r->b, spans + 1);
+
+        ssize_t nread = _io_reader_readv(r, spans, nspans);
+        if (nread < 0) return _io_read_err();
+        if (nread == 0) return copied > 0 ? IO_ERR_PARTIAL : IO_ERR_EOF;
+
+        size_t direct = MIN((size_t)nread, n - copied);
+        _io_buffer_commit(r->b, nread - direct);
+        copied += direct;
+        r->pos += direct;
+        r->nread += nread;
+    }
+
+    IO_ASSERT(r->pos <= r->nread && "Out of bounds");
+    return IO_ERR_OK;
+}
+
+/**
+ * Moves position (`*i`, `*off`) within the `cnt` regions described by `iov`
+ * forward by `n` bytes, skipping regions that are filled.
+ */
+static inline void _io_spans_advance(const IO_Span *iov, int cnt, int *i, size_t *off, size_t n) {
+    while (*i < cnt && n >= iov[*i].len - *off) {
+        n -= iov[*i].len - *off;
+        *off = 0;
+        (*i)++;
+    }
+    *off += n;
+}
+
+IO_Err io_reader_nreadv(IO_Reader *r, const IO_Span *iov, int cnt) {
+    size_t start_pos = r->pos, off = 0;
+    int i = 0;
+    _io_spans_advance(iov, cnt, &i, &off, 0);
+    for (;;) {
+        while (i < cnt && io_reader_buffered(r) > 0) {
+            size_t to_copy = MIN(iov[i].len - off, io_reader_buffered(r));
+            IO_ASSERT(io_reader_nconsume(r, iov[i].ptr + off, to_copy) == IO_ERR_OK);
+            _io_spans_advance(iov, cnt, &i, &off, to_copy);
+        }
+        if (i == cnt) break;
+
+        // NOTE: Same as in io_reader_nread_full(): the drained buffer is
+        //       rewound, so it adds a single region after the caller's ones.
+        //       What it reads ahead is drained into the regions that did
+        //       not fit into this read.
+        IO_Span spans[IO_READV_MAX];
+        int nspans = 0;
+        size_t want = 0;
+        for (int j = i; j < cnt && nspans < IO_READV_MAX - 1; j++) {
+            size_t skip = (j == i) ? off : 0;
+            spans[nspans++] = (IO_Span){.ptr = iov[j].ptr + skip, .len = iov[j].len - skip};
+            want += iov[j].len - skip;
+        }
+        IO_ASSERT(io_reader_buffered(r) == 0);
+        nspans += io_buffer_reserve_spans(r->b, spans + nspans);
+
+        ssize_t nread = _io_reader_readv(r, spans, nspans);
+        if (nread < 0) return _io_read_err();
+        if (nread == 0) return r->pos > start_pos ? IO_ERR_PARTIAL : IO_ERR_EOF;
+
+        size_t direct = MIN((size_t)nread, want);
+        _io_buffer_commit(r->b, nread - direct);
+        _io_spans_advance(iov, cnt, &i, &off, direct);
+        r->pos += direct;
+        r->nread += nread;
+    }
+
+    IO_ASSERT(r->pos <= r->nread && "Out of bounds");
+    return IO_ERR_OK;
+}
+
+/**
+ * Makes `rec` describe the first `n` buffered bytes of reader (`r`), copying
+ * them into `scratch` only if they wrap around the internal buffer, and then
+ * consumes `n + skip` bytes.
+ */
+static IO_Err _io_reader_take_record(IO_Reader *r, size_t n, size_t skip,
+                                     IO_Span *rec, char *scratch) {
+    IO_Buffer *b = r->b;
+    size_t offset = b->start - b->buf;
+    if (offset + n <= _io_buffer_size(b) || (b->flags & IO_BUFFER_MIRRORED)) {
+        *rec = (IO_Span){.ptr = b->start, .len = n};
+    } else {
+        if (scratch == NULL) return IO_ERR_OOB;
+        IO_ASSERT(_io_reader_copy_out(r, scratch, n) == IO_ERR_OK);
+        *rec = (IO_Span){.ptr = scratch, .len = n};
+    }
+    return io_reader_nconsume(r, NULL, n + skip);
+}
+
+IO_Err io_reader_read_until(IO_Reader *r, const char *delim, size_t dlen,
+                            IO_Span *rec, char *scratch, size_t maxlen) {
+    // NOTE: A mapped buffer already holds the whole rest of the file, so it
+    //       is never filled: no delimiter in it means the stream ends there.
+    bool mapped = r->b->flags & IO_BUFFER_MAPPED;
+    size_t max_cap = (r->b->flags & IO_BUFFER_GROWABLE) ? r->b->max_cap : r->b->cap;
+    if (dlen == 0 || (!mapped && dlen > max_cap)) return IO_ERR_OOB;
+
+    size_t limit = mapped ? maxlen : MIN(maxlen, max_cap - dlen);
+    size_t from = 0;
+    for (;;) {
+        size_t buffered = io_reader_buffered(r);
+        size_t pos = io_buffer_find(r->b, from, delim, dlen);
+        if (pos != IO_NOT_FOUND) {
+            if (pos > limit) return IO_ERR_OOB;
+            return _io_reader_take_record(r, pos, dlen, rec, scratch);
+        }
+
+        if (!mapped) {
+            if (buffered >= limit + dlen) return IO_ERR_OOB;
+
+            // NOTE: The delimiter may start in the last `dlen - 1` bytes that
+            //       are already buffered, so those are searched again after
+            //       the fill.
+            from = (buffered >= dlen) ? buffered - dlen + 1 : 0;
+
+            if (buffered == r->b->cap) {
+                IO_Err err = io_buffer_reserve(r->b, 1);
+                if (err != IO_ERR_OK) return err;
+            }
+            IO_Err err = io_reader_fill(r, r->b->cap - buffered);
+            if (err == IO_ERR_OK || err == IO_ERR_PARTIAL) continue;
+            if (err != IO_ERR_EOF) return err;
+        }
+        if (buffered == 0) return IO_ERR_EOF;
+        if (buffered > limit) return IO_ERR_OOB;
+
+        IO_Err err = _io_reader_take_record(r, buffered, 0, rec, scratch);
+        return (err == IO_ERR_OK) ? IO_ERR_PARTIAL : err;
+    }
+}
+
+/**
+ * Decoders of frame headers (see `IO_FRAME_MAP`): decode the header of the
+ * frame that starts `off` bytes into the data of IO buffer `b`, of which
+ * `avail` bytes are buffered, into `len`. They return the size of the header,
+ * 0 if it is not completely buffered yet, or `IO_NOT_FOUND` if it is
+ * malformed.
+ */
+#define XX(name, width, big_endian)                                     \
+    static inline size_t _io_frame_header_##name(IO_Buffer *b, size_t off, size_t avail, uint64_t *len) { \
+        if (avail < (width)) return 0;                                  \
+        uint64_t v = 0;                                                 \
+        for (size_t i = 0; i < (width); i++) {                          \
+            size_t shift = 8 * ((big_endian) ? (width) - 1 - i : i);    \
+            v |= (uint64_t)(unsigned char)io_buffer_at(b, off + i) << shift; \
+        }                                                               \
+        *len = v;                                                       \
+        return (width);                                                 \
+    }
+IO_FRAME_MAP(XX)
+#undef XX
+
+static inline size_t _io_frame_header_varint(IO_Buffer *b, size_t off, size_t avail, uint64_t *len) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < 10; i++) {
+        if (i >= avail) return 0;
+        unsigned char byte = io_buffer_at(b, off + i);
+        if (i == 9 && byte > 1) return IO_NOT_FOUND;
+        v |= (uint64_t)(byte & 0x7f) << (7 * i);
+        if (!(byte & 0x80)) {
+            *len = v;
+            return i + 1;
+        }
+    }
+    return IO_NOT_FOUND;
+}
+
+typedef size_t (*_IO_FrameHeader)(IO_Buffer *b, size_t off, size_t avail, uint64_t *len);
+
+/**
+ * Makes `f` describe the `len` bytes of data that start `off` bytes into the
+ * data of IO buffer `b`, directly in its storage.
+ */
+static inline void _io_buffer_frame_view(IO_Buffer *b, size_t off, size_t len, IO_Frame *f) {
+    size_t phys = _io_buffer_wrap(b, (b->start - b->buf) + off);
+    size_t first = (b->flags & IO_BUFFER_MIRRORED) ? len : MIN(len, _io_buffer_size(b) - phys);
+    *f = (IO_Frame){.spans = {{.ptr = b->buf + phys, .len = first}}, .nspans = (len > 0), .len = len};
+    if (first < len) {
+        f->spans[1] = (IO_Span){.ptr = b->buf, .len = len - first};
+        f->nspans = 2;
+    }
+}
+
+/**
+ * Reads the next frame with headers decoded by `header`, which are at least
+ * `hmin` bytes long, from reader (`r`). See io_reader_read_frame_u32be().
+ */
+static inline IO_Err _io_reader_read_frame(IO_Reader *r, _IO_FrameHeader header, size_t hmin,
+                                           IO_Frame *f, char *dest, size_t maxlen) {
+    uint64_t len;
+    size_t hlen;
+    for (size_t need = hmin;; need = io_reader_buffered(r) + 1) {
+        IO_Err err = io_reader_prefetch_all(r, need);
+        if (err != IO_ERR_OK) return err;
+        hlen = header(r->b, 0, io_reader_buffered(r), &len);
+        if (hlen == IO_NOT_FOUND) return IO_ERR_OOB;
+        if (hlen > 0) break;
+    }
+    if (len > maxlen) return IO_ERR_OOB;
+
+    IO_Buffer *b = r->b;
+    size_t max_cap = (b->flags & IO_BUFFER_GROWABLE) ? b->max_cap : b->cap;
+    if (len > max_cap - hlen) {
+        if (dest == NULL) return IO_ERR_OOB;
+        IO_ASSERT(io_reader_nconsume(r, NULL, hlen) == IO_ERR_OK);
+        IO_Err err = io_reader_nread_full(r, dest, len);
+        if (err == IO_ERR_EOF) return IO_ERR_PARTIAL;
+        if (err != IO_ERR_OK) return err;
+        *f = (IO_Frame){.spans = {{.ptr = dest, .len = len}}, .nspans = 1, .len = len};
+        return IO_ERR_OK;
+    }
+
+    IO_Err err = io_reader_prefetch_all(r, hlen + len);
+    if (err != IO_ERR_OK) return err;
+
+    // NOTE: The payload stays in the storage after it is consumed, until the
+    //       next read overwrites it.
+    _io_buffer_frame_view(b, hlen, len, f);
+    return io_reader_nconsume(r, NULL, hlen + len);
+}
+
+/**
+ * Describes up to `max` complete frames with headers decoded by `header`
+ * that are buffered by reader (`r`) in `frames`, without consuming them.
+ * Returns the number of frames and sets `consumed` to their total size.
+ */
+static inline size_t _io_reader_scan_frames(IO_Reader *r, _IO_FrameHeader header, IO_Frame *frames,
+                                            size_t max, size_t maxlen, size_t *consumed) {
+    IO_Buffer *b = r->b;
+    size_t buffered = io_buffer_len(b), off = 0, n = 0;
+    while (n < max) {
+        uint64_t len;
+        size_t hlen = header(b, off, buffered - off, &len);
+        if (hlen == 0 || hlen == IO_NOT_FOUND) break;
+        if (len > maxlen || len > buffered - off - hlen) break;
+        _io_buffer_frame_view(b, off + hlen, len, &frames[n++]);
+        off += hlen + len;
+    }
+    *consumed = off;
+    return n;
+}
+
+/**
+ * Batch version of _io_reader_read_frame(). See io_reader_read_frames_u32be().
+ */
+static inline IO_Err _io_reader_read_frames(IO_Reader *r, _IO_FrameHeader header, size_t hmin,
+                                            IO_Frame *frames, size_t *nframes, size_t maxlen) {
+    size_t max = *nframes, consumed;
+    *nframes = 0;
+    if (max == 0) return IO_ERR_OK;
+
+    size_t n = _io_reader_scan_frames(r, header, frames, max, maxlen, &consumed);
+    if (n == 0) {
+        // NOTE: Read as much as fits first, so the frames pipelined after the
+        //       first one come with the same read.
+        IO_Err err = io_reader_fill(r, r->b->cap - io_reader_buffered(r));
+        if (err == IO_ERR_AGAIN) return err;
+        n = _io_reader_scan_frames(r, header, frames, max, maxlen, &consumed);
+    }
+    if (n == 0) {
+        IO_Err err = _io_reader_read_frame(r, header, hmin, frames, NULL, maxlen);
+        if (err != IO_ERR_OK) return err;
+        n = 1 + _io_reader_scan_frames(r, header, frames + 1, max - 1, maxlen, &consumed);
+    }
+    IO_ASSERT(io_reader_nconsume(r, NULL, consumed) == IO_ERR_OK);
+    *nframes = n;
+    return IO_ERR_OK;
+}
+
+#define _IO_FRAME_IMPL(name, hmin)                                      \
+    IO_Err io_reader_read_frame_##name(IO_Reader *r, IO_Frame *f, char *dest, size_t maxlen) { \
+        return _io_reader_read_frame(r, _io_frame_header_##name, (hmin), f, dest, maxlen); \
+    }                                                                   \
+    IO_Err io_reader_read_frames_##name(IO_Reader *r, IO_Frame *frames, size_t *nframes, size_t maxlen) { \
+        return _io_reader_read_frames(r, _io_frame_header_##name, (hmin), frames, nframes, maxlen); \
+    }
+#define XX(name, width, big_endian) _IO_FRAME_IMPL(name, width)
+IO_FRAME_MAP(XX)
+#undef XX
+_IO_FRAME_IMPL(varint, 1)
+#undef _IO_FRAME_IMPL
+
+/**
+ * Describes up to `max` complete records terminated by `delim` that are
+ * buffered by reader (`r`) in `recs`, without consuming them. A record that
+ * wraps around the buffer is copied into `scratch` if it is not NULL, which
+ * is then set to NULL (the data wraps at most once). Returns the number of
+ * records and sets `consumed` to their total size with delimiters.
+ */
+static size_t _io_reader_scan_records(IO_Reader *r, const char *delim, size_t dlen, IO_Span *recs,
+                                      size_t max, char **scratch, size_t maxlen, size_t *consumed) {
+    IO_Buffer *b = r->b;
+    size_t buffered = io_buffer_len(b), off = 0, n = 0;
+    size_t size = _io_buffer_size(b), start = b->start - b->buf;
+    IO_Span spans[2];
+    size_t nspans = io_buffer_peek_spans(b, spans);
+    while (n < max && off < buffered) {
+        // NOTE: Single byte delimiters are looked for with memchr() in the
+        //       spans directly, skipping the general search per record.
+        size_t pos = IO_NOT_FOUND;
+        if (dlen == 1) {
+            const char *found = NULL;
+            if (off < spans[0].len) found = memchr(spans[0].ptr + off, delim[0], spans[0].len - off);
+            if (found != NULL) {
+                pos = found - spans[0].ptr;
+            } else if (nspans == 2) {
+                size_t skip = (off > spans[0].len) ? off - spans[0].len : 0;
+                found = memchr(spans[1].ptr + skip, delim[0], spans[1].len - skip);
+                if (found != NULL) pos = spans[0].len + (found - spans[1].ptr);
+            }
+        } else {
+            pos = io_buffer_find(b, off, delim, dlen);
+        }
+        if (pos == IO_NOT_FOUND || pos - off > maxlen) break;
+
+        size_t len = pos - off, phys = _io_buffer_wrap(b, start + off);
+        if (phys + len <= size || (b->flags & IO_BUFFER_MIRRORED)) {
+            recs[n++] = (IO_Span){.ptr = b->buf + phys, .len = len};
+        } else {
+            if (*scratch == NULL) break;
+            size_t first = size - phys;
+            memcpy(*scratch, b->buf + phys, first);
+            memcpy(*scratch + first, b->buf, len - first);
+            recs[n++] = (IO_Span){.ptr = *scratch, .len = len};
+            *scratch = NULL;
+        }
+        off = pos + dlen;
+    }
+    *consumed = off;
+    return n;
+}
+
+IO_Err io_reader_read_records(IO_Reader *r, const char *delim, size_t dlen, IO_Span *recs,
+                              size_t *nrecs, char *scratch, size_t maxlen) {
+    size_t max = *nrecs, consumed;
+    *nrecs = 0;
+    if (max == 0) return IO_ERR_OK;
+    if (dlen == 0) return IO_ERR_OOB;
+
+    size_t n = _io_reader_scan_records(r, delim, dlen, recs, max, &scratch, maxlen, &consumed);
+    if (n == 0) {
+        IO_Err err = io_reader_read_until(r, delim, dlen, recs, scratch, maxlen);
+        if (err == IO_ERR_PARTIAL) *nrecs = 1;
+        if (err != IO_ERR_OK) return err;
+        if (recs[0].ptr == scratch) scratch = NULL;
+        n = 1 + _io_reader_scan_records(r, delim, dlen, recs + 1, max - 1, &scratch, maxlen, &consumed);
+    }
+    IO_ASSERT(io_reader_nconsume(r, NULL, consumed) == IO_ERR_OK);
+    *nrecs = n;
+    return IO_ERR_OK;
+}
+
+IO_Err io_reader_readline(IO_Reader *r, IO_Span *line, char *scratch, size_t maxlen) {
+    IO_Err err = io_reader_read_until(r, "\n", 1, line, scratch, maxlen);
+    if (err == IO_ERR_OK && line->len > 0 && line->ptr[line->len - 1] == '\r') line->len--;
+    return err;
+}
+
+IO_Err io_writer_init(IO_Writer *w, IO_Buffer *b, int fd) {
+    w->b = b;
+    w->fd = fd;
+    w->nwritten = w->nflushed = 0;
+    return IO_ERR_OK;
+}
+
+size_t io_writer_pending(IO_Writer *w) {
+    IO_ASSERT(w->nwritten >= w->nflushed && w->nwritten - w->nflushed == io_buffer_len(w->b) && "Out of bounds");
+    return w->nwritten - w->nflushed;
+}
+
+/**
+ * Performs a single vectored write of the data buffered by writer (`w`)
+ * followed by `n` bytes of `src`, and returns how many bytes of `src` were
+ * written. Buffered data is always written first.
+ *
+ * Sets `*err` to `IO_ERR_OK` on success, or to the error of a failed write.
+ */
+static size_t _io_writer_writev(IO_Writer *w, const char *src, size_t n, IO_Err *err) {
+    IO_Span spans[2];
+    struct iovec iov[3];
+    int cnt = 0;
+
+    size_t nspans = io_buffer_peek_spans(w->b, spans);
+    for (size_t i = 0; i < nspans; i++) {
+        iov[cnt++] = (struct iovec){.iov_base = spans[i].ptr, .iov_len = spans[i].len};
+    }
+    if (n > 0) iov[cnt++] = (struct iovec){.iov_base = (char *)src, .iov_len = n};
+
+    *err = IO_ERR_OK;
+    if (cnt == 0) return 0;
+
+    ssize_t nwritten = _io_writev(w->fd, iov, cnt);
+    if (nwritten < 0) {
+        *err = _io_write_err();
+        return 0;
+    }
+    if (nwritten == 0) {
+        *err = IO_ERR_FAILED_WRITE;
+        return 0;
+    }
+
+    size_t from_buffer = io_buffer_nadvance(w->b, nwritten);
+    w->nflushed += from_buffer;
+
+    size_t from_src = nwritten - from_buffer;
+    w->nwritten += from_src;
+    w->nflushed += from_src;
+    return from_src;
+}
+
+IO_Err io_writer_write(IO_Writer *w, const char *src, size_t n) {
+    IO_Err err = IO_ERR_OK;
+    while (n > w->b->cap - io_buffer_len(w->b)) {
+        size_t written = _io_writer_writev(w, src, n, &err);
+        if (err != IO_ERR_OK) break;
+        src += written;
+        n -= written;
+    }
+
+    // NOTE: Even if the file descriptor would block, accept as much as fits.
+    size_t to_append = MIN(n, w->b->cap - io_buffer_len(w->b));
+    IO_ASSERT(io_buffer_append(w->b, (char *)src, to_append) == IO_ERR_OK);
+    w->nwritten += to_append;
+
+    if (to_append < n) return err;
+    return IO_ERR_OK;
+}
+
+IO_Err io_writer_flush(IO_Writer *w) {
+    IO_Err err = IO_ERR_OK;
+    while (io_writer_pending(w) > 0) {
+        _io_writer_writev(w, NULL, 0, &err);
+        if (err != IO_ERR_OK) return err;
+    }
+    return IO_ERR_OK;
+}
+
+IO_Err io_pipe_init(IO_Pipe *p) {
+    p->pending = 0;
+    if (pipe(p->fds) != 0) return IO_ERR_UNSUPPORTED;
+    return IO_ERR_OK;
+}
+
+IO_Err io_pipe_free(IO_Pipe *p) {
+    close(p->fds[0]);
+    close(p->fds[1]);
+    p->fds[0] = p->fds[1] = -1;
+    p->pending = 0;
+    return IO_ERR_OK;
+}
+
+/**
+ * Writes up to `n` bytes buffered by reader (`r`) to file descriptor `fd` and
+ * consumes them, decreasing `n` by the number of bytes written.
+ */
+static IO_Err _io_reader_forward_buffered(IO_Reader *r, int fd, size_t *n) {
+    while (*n > 0 && io_reader_buffered(r) > 0) {
+        IO_Span spans[2];
+        size_t nspans = io_buffer_peek_spans(r->b, spans);
+        struct iovec iov[2];
+        size_t left = *n;
+        int cnt = 0;
+        for (size_t i = 0; i < nspans && left > 0; i++, cnt++) {
+            size_t len = MIN(spans[i].len, left);
+            iov[i] = (struct iovec){.iov_base = spans[i].ptr, .iov_len = len};
+            left -= len;
+        }
+
+        ssize_t nwritten = _io_writev(fd, iov, cnt);
+        if (nwritten < 0) return _io_write_err();
+        if (nwritten == 0) return IO_ERR_FAILED_WRITE;
+        IO_ASSERT(io_reader_nconsume(r, NULL, nwritten) == IO_ERR_OK);
+        *n -= nwritten;
+    }
+    return IO_ERR_OK;
+}
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+
+#define _IO_SPLICE_F_MOVE 1
+
+/**
+ * Wrappers around `splice(2)` and `copy_file_range(2)`, which are only
+ * declared with `_GNU_SOURCE`.
+ */
+static inline ssize_t _io_splice(int in, int out, size_t n) {
+    ssize_t moved;
+    do moved = syscall(__NR_splice, in, NULL, out, NULL, n, _IO_SPLICE_F_MOVE); while (moved < 0 && errno == EINTR);
+    return moved;
+}
+
+static inline ssize_t _io_copy_file_range(int in, int out, size_t n) {
+#ifdef __NR_copy_file_range
+    ssize_t moved;
+    do moved = syscall(__NR_copy_file_range, in, NULL, out, NULL, n, 0); while (moved < 0 && errno == EINTR);
+    return moved;
+#else // __NR_copy_file_range
+    (void)in; (void)out; (void)n;
+    errno = ENOSYS;
+    return -1;
+#endif // __NR_copy_file_range
+}
+
+static inline ssize_t _io_sendfile(int in, int out, size_t n) {
+    ssize_t moved;
+    do moved = sendfile(out, in, NULL, n); while (moved < 0 && errno == EINTR);
+    return moved;
+}
+
+/**
+ * Returns true if `err` means that the kernel can't move data between the
+ * given file descriptors, so it has to go through user space instead.
+ */
+static inline bool _io_forward_unsupported(int err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP;
+}
+
+/**
+ * Maps `errno` of a failed transfer between two file descriptors to the side
+ * that failed: errors only the destination can cause are write failures.
+ */
+static inline IO_Err _io_forward_err(void) {
+    if (errno == EPIPE || errno == ENOSPC || errno == EDQUOT || errno == EFBIG) return _io_write_err();
+    return _io_read_err();
+}
+
+/**
+ * Writes up to `*n` bytes pending in pipe `p` to file descriptor `fd` and
+ * counts them as read and consumed by reader (`r`), decreasing `*n` by the
+ * number of bytes written.
+ */
+static IO_Err _io_reader_forward_pending(IO_Reader *r, int fd, size_t *n, IO_Pipe *p) {
+    while (*n > 0 && p->pending > 0) {
+        ssize_t moved = _io_splice(p->fds[0], fd, MIN(*n, p->pending));
+        if (moved < 0) return _io_write_err();
+        p->pending -= moved;
+        r->nread += moved;
+        r->pos += moved;
+        *n -= moved;
+    }
+    return IO_ERR_OK;
+}
+
+/**
+ * Forwards up to `*n` bytes from the file descriptor of reader (`r`) to file
+ * descriptor `fd` inside the kernel, decreasing `*n` by the number of bytes
+ * forwarded. Returns `IO_ERR_UNSUPPORTED` if the kernel can't do it.
+ */
+static IO_Err _io_reader_forward_kernel(IO_Reader *r, int fd, size_t *n, IO_Pipe *p) {
+    struct stat in, out;
+    if (fstat(r->fd, &in) != 0 || fstat(fd, &out) != 0) return IO_ERR_UNSUPPORTED;
+    bool use_pipe = !S_ISREG(in.st_mode) && !S_ISFIFO(in.st_mode) && !S_ISFIFO(out.st_mode);
+    if (use_pipe && p == NULL) return IO_ERR_UNSUPPORTED;
+    // NOTE: copy_file_range() refuses destinations opened with `O_APPEND`.
+    bool copy_range = S_ISREG(in.st_mode) && S_ISREG(out.st_mode) && !(fcntl(fd, F_GETFL) & O_APPEND);
+
+    while (*n > 0) {
+        ssize_t moved;
+        if (use_pipe) {
+            moved = _io_splice(r->fd, p->fds[1], *n);
+            if (moved < 0 && _io_forward_unsupported(errno)) return IO_ERR_UNSUPPORTED;
+            if (moved < 0) return _io_read_err();
+            if (moved == 0) return IO_ERR_EOF;
+            p->pending += moved;
+            IO_Err err = _io_reader_forward_pending(r, fd, n, p);
+            if (err != IO_ERR_OK) return err;
+            continue;
+        }
+
+        if (copy_range) {
+            moved = _io_copy_file_range(r->fd, fd, *n);
+            if (moved < 0 && _io_forward_unsupported(errno)) copy_range = false;
+            if (!copy_range) continue;
+        } else if (S_ISREG(in.st_mode)) {
+            moved = _io_sendfile(r->fd, fd, *n);
+        } else {
+            moved = _io_splice(r->fd, fd, *n);
+        }
+        if (moved < 0 && _io_forward_unsupported(errno)) return IO_ERR_UNSUPPORTED;
+        if (moved < 0) return _io_forward_err();
+        if (moved == 0) return IO_ERR_EOF;
+
+        // NOTE: Bytes moved by the kernel count as read and consumed at once,
+        //       which keeps `nread - pos` equal to the buffered length.
+        r->nread += moved;
+        r->pos += moved;
+        *n -= moved;
+    }
+    return IO_ERR_OK;
+}
+#endif // __linux__
+
+IO_Err io_reader_forward(IO_Reader *r, int fd, size_t n, IO_Pipe *p) {
+    size_t start_pos = r->pos, left = n;
+    IO_Err err = IO_ERR_OK;
+#ifdef __linux__
+    // NOTE: Bytes pending in the pipe were taken from the stream before
+    //       anything buffered since, so they go out first.
+    if (p != NULL) err = _io_reader_forward_pending(r, fd, &left, p);
+#endif // __linux__
+    if (err == IO_ERR_OK) err = _io_reader_forward_buffered(r, fd, &left);
+
+#ifdef __linux__
+    if (err == IO_ERR_OK && left > 0 && r->src.read == NULL && !(r->b->flags & IO_BUFFER_MAPPED)) {
+        err = _io_reader_forward_kernel(r, fd, &left, p);
+        if (err == IO_ERR_UNSUPPORTED) err = IO_ERR_OK;
+    }
+#else // __linux__
+    (void)p;
+#endif // __linux__
+
+    while (err == IO_ERR_OK && left > 0) {
+        err = io_reader_fill(r, MIN(left, r->b->cap));
+        if (err == IO_ERR_OK || err == IO_ERR_PARTIAL) err = _io_reader_forward_buffered(r, fd, &left);
+    }
+
+    if (err == IO_ERR_EOF && r->pos > start_pos) return IO_ERR_PARTIAL;
+    return err;
+}
+
+/**
+ * `IO_Source.readv` of a reader set up by io_reader_init_decoder(): decodes
+ * the compressed data buffered by `d->src` into `spans`, reading more of it
+ * only when the codec needs more input and nothing was decoded yet.
+ */
+static ssize_t _io_decoder_readv(void *ctx, const IO_Span *spans, int cnt) {
+    IO_Decoder *d = ctx;
+    size_t produced = 0, off = 0;
+    int i = 0;
+    _io_spans_advance(spans, cnt, &i, &off, 0);
+
+    while (i < cnt && !d->done) {
+        IO_Span in[2] = {{NULL, 0}};
+        io_buffer_peek_spans(d->src->b, in);
+        int flags = (d->eof && in[0].len == 0) ? IO_CODEC_END : 0;
+        size_t nin = in[0].len, nout = spans[i].len - off;
+        IO_Err err = d->codec.step(d->codec.ctx, in[0].ptr, &nin, spans[i].ptr + off, &nout, flags);
+        if (err != IO_ERR_OK && err != IO_ERR_EOF) {
+            d->err = err;
+            errno = EIO;
+            return -1;
+        }
+        IO_ASSERT(io_reader_nconsume(d->src, NULL, nin) == IO_ERR_OK);
+        _io_spans_advance(spans, cnt, &i, &off, nout);
+        produced += nout;
+        if (err == IO_ERR_EOF) d->done = true;
+        if (nin > 0 || nout > 0) continue;
+
+        // NOTE: No progress with free output space: the codec needs more input.
+        if (in[0].len > 0) {
+            d->err = IO_ERR_FAILED_READ;
+            errno = EIO;
+            return -1;
+        }
+        if (flags & IO_CODEC_END) d->done = true;
+        if (d->done || produced > 0) break;
+
+        err = io_reader_fill(d->src, d->src->b->cap);
+        if (err == IO_ERR_EOF) {
+            d->eof = true;
+        } else if (err == IO_ERR_AGAIN) {
+            errno = EAGAIN;
+            return -1;
+        } else if (err != IO_ERR_OK && err != IO_ERR_PARTIAL) {
+            errno = EIO;
+            return -1;
+        }
+    }
+    return produced;
+}
+
+static ssize_t _io_decoder_read(void *ctx, char *buf, size_t n) {
+    IO_Span span = {.ptr = buf, .len = n};
+    return _io_decoder_readv(ctx, &span, 1);
+}
+
+IO_Err io_reader_init_decoder(IO_Reader *r, IO_Buffer *b, IO_Decoder *d,
+                              IO_Reader *src, const IO_Codec *codec) {
+    if (codec->step == NULL) return IO_ERR_UNSUPPORTED;
+    *d = (IO_Decoder){.src = src, .codec = *codec, .err = IO_ERR_OK};
+    IO_Source source = {.read = _io_decoder_read, .readv = _io_decoder_readv, .ctx = d};
+    return io_reader_init_source(r, b, &source);
+}
+
+IO_Err io_encoder_init(IO_Encoder *e, IO_Writer *dst, const IO_Codec *codec) {
+    if (codec->step == NULL) return IO_ERR_UNSUPPORTED;
+    *e = (IO_Encoder){.dst = dst, .codec = *codec};
+    return IO_ERR_OK;
+}
+
+/**
+ * Runs the codec of encoder `e` over `n` bytes from `src` with `flags`,
+ * writing the output into the free space of `e->dst`'s buffer and flushing
+ * it whenever it is full. Stops once the input is consumed, or once the codec
+ * reports `IO_ERR_EOF` if `flags` are set.
+ */
+static IO_Err _io_encoder_step(IO_Encoder *e, const char *src, size_t n, int flags) {
+    IO_Writer *w = e->dst;
+    for (;;) {
+        IO_Span out[2];
+        if (io_buffer_reserve_spans(w->b, out) == 0) {
+            IO_Err err = io_writer_flush(w);
+            if (err != IO_ERR_OK) return err;
+            continue;
+        }
+
+        size_t nin = n, nout = out[0].len;
+        IO_Err err = e->codec.step(e->codec.ctx, src, &nin, out[0].ptr, &nout, flags);
+        if (err != IO_ERR_OK && err != IO_ERR_EOF) return err;
+        _io_buffer_commit(w->b, nout);
+        w->nwritten += nout;
+        src += nin;
+        n -= nin;
+        e->nwritten += nin;
+
+        if (flags ? err == IO_ERR_EOF : n == 0) return IO_ERR_OK;
+        if (nin == 0 && nout == 0) return IO_ERR_FAILED_WRITE;
+    }
+}
+
+IO_Err io_encoder_write(IO_Encoder *e, const char *src, size_t n) {
+    if (n == 0) return IO_ERR_OK;
+    return _io_encoder_step(e, src, n, 0);
+}
+
+IO_Err io_encoder_flush(IO_Encoder *e) {
+    IO_Err err = _io_encoder_step(e, NULL, 0, IO_CODEC_FLUSH);
+    if (err != IO_ERR_OK) return err;
+    return io_writer_flush(e->dst);
+}
+
+IO_Err io_encoder_finish(IO_Encoder *e) {
+    IO_Err err = _io_encoder_step(e, NULL, 0, IO_CODEC_END);
+    if (err != IO_ERR_OK) return err;
+    return io_writer_flush(e->dst);
+}
+
+#if defined(IO_URING) && defined(__linux__)
+#include <linux/io_uring.h>
+
+static inline int _io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int _io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static inline int _io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/**
+ * Maps the submission and completion rings of engine `a` set up with
+ * parameters `p`.
+ */
+static IO_Err _io_async_map_rings(IO_Async *a, struct io_uring_params *p) {
+    a->sq_ring_sz = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+    a->cq_ring_sz = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        a->sq_ring_sz = a->cq_ring_sz = MAX(a->sq_ring_sz, a->cq_ring_sz);
+    }
 
-#ifndef IO_READ
-// TODO: Depending on platform, use different implementations of `read()`
-#  include <unistd.h>
-#  define IO_READ read
-#endif // IO_READ
+    a->sq_ring = mmap(NULL, a->sq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      a->fd, IORING_OFF_SQ_RING);
+    if (a->sq_ring == MAP_FAILED) return IO_ERR_OOM;
 
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        a->cq_ring = a->sq_ring;
+    } else {
+        a->cq_ring = mmap(NULL, a->cq_ring_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          a->fd, IORING_OFF_CQ_RING);
+        if (a->cq_ring == MAP_FAILED) return IO_ERR_OOM;
+    }
 
-#ifndef MIN
-#  define MIN(a, b) (((a) < (b)) ? (a) : (b))
-#endif // MIN
+    a->sqes_sz = p->sq_entries * sizeof(struct io_uring_sqe);
+    a->sqes = mmap(NULL, a->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   a->fd, IORING_OFF_SQES);
+    if (a->sqes == MAP_FAILED) return IO_ERR_OOM;
 
+    char *sq = a->sq_ring, *cq = a->cq_ring;
+    a->sq_head  = (unsigned *)(sq + p->sq_off.head);
+    a->sq_tail  = (unsigned *)(sq + p->sq_off.tail);
+    a->sq_mask  = (unsigned *)(sq + p->sq_off.ring_mask);
+    a->sq_array = (unsigned *)(sq + p->sq_off.array);
+    a->cq_head  = (unsigned *)(cq + p->cq_off.head);
+    a->cq_tail  = (unsigned *)(cq + p->cq_off.tail);
+    a->cq_mask  = (unsigned *)(cq + p->cq_off.ring_mask);
+    a->cqes     = (struct io_uring_cqe *)(cq + p->cq_off.cqes);
+    a->sq_entries = p->sq_entries;
+    return IO_ERR_OK;
+}
 
-const char *io_err_to_cstr(IO_Err err) {
-#define XX(num, name, repr) if (err == num) return repr;
-    IO_ERR_MAP(XX)
-#undef XX
-    IO_ASSERT(0 && "Unreachable");
-    // NOTE: Suppressing warning:
-    //       control reaches end of non-void function [-Wreturn-type]
-    return "";
+IO_Err io_async_init(IO_Async *a, IO_Reader **readers, size_t nreaders) {
+    return io_async_init_rw(a, readers, nreaders, NULL, 0);
 }
 
-IO_Err io_buffer_init(IO_Buffer *b, size_t cap) {
-    b->cap = cap;
-    b->end = b->start = b->buf = IO_MALLOC(cap + 1);
-    if (b->buf == NULL) return IO_ERR_OOM;
+/**
+ * Returns the buffer of slot `i` of engine `a` (see `IO_Async`).
+ */
+static inline IO_Buffer *_io_async_buffer(IO_Async *a, size_t i) {
+    return (i < a->nreaders) ? a->readers[i]->b : a->writers[i - a->nreaders]->b;
+}
+
+IO_Err io_async_init_rw(IO_Async *a, IO_Reader **readers, size_t nreaders,
+                        IO_Writer **writers, size_t nwriters) {
+    memset(a, 0, sizeof(*a));
+    a->fd = -1;
+    a->sq_ring = a->cq_ring = a->sqes = MAP_FAILED;
+    size_t nslots = nreaders + nwriters;
+    if (nslots == 0) return IO_ERR_OOB;
+
+    // NOTE: Allocates at least one entry, so that an empty side is not
+    //       mistaken for a failed allocation.
+    a->readers = IO_MALLOC(MAX(nreaders, 1) * sizeof(*a->readers));
+    a->writers = IO_MALLOC(MAX(nwriters, 1) * sizeof(*a->writers));
+    a->inflight = IO_MALLOC(nslots * sizeof(*a->inflight));
+    a->active = IO_MALLOC(nslots * sizeof(*a->active));
+    a->iov = IO_MALLOC(2 * nslots * sizeof(*a->iov));
+    if (a->readers == NULL || a->writers == NULL || a->inflight == NULL || a->active == NULL ||
+        a->iov == NULL) {
+        io_async_free(a);
+        return IO_ERR_OOM;
+    }
+    for (size_t i = 0; i < nreaders; i++) {
+        if (readers[i]->src.read != NULL || (readers[i]->b->flags & IO_BUFFER_GROWABLE)) {
+            io_async_free(a);
+            return IO_ERR_UNSUPPORTED;
+        }
+    }
+    for (size_t i = 0; i < nwriters; i++) {
+        if (writers[i]->b->flags & IO_BUFFER_GROWABLE) {
+            io_async_free(a);
+            return IO_ERR_UNSUPPORTED;
+        }
+    }
+    if (nreaders > 0) memcpy(a->readers, readers, nreaders * sizeof(*readers));
+    if (nwriters > 0) memcpy(a->writers, writers, nwriters * sizeof(*writers));
+    memset(a->inflight, 0, nslots * sizeof(*a->inflight));
+    for (size_t i = 0; i < nslots; i++) a->active[i] = true;
+    a->nreaders = nreaders;
+    a->nwriters = nwriters;
+    a->err = IO_ERR_OK;
+
+    struct io_uring_params p = {0};
+    a->fd = _io_uring_setup(nslots, &p);
+    if (a->fd < 0) {
+        io_async_free(a);
+        return IO_ERR_UNSUPPORTED;
+    }
+
+    IO_Err err = _io_async_map_rings(a, &p);
+    if (err != IO_ERR_OK) {
+        io_async_free(a);
+        return err;
+    }
+
+    for (size_t i = 0; i < nslots; i++) {
+        IO_Buffer *b = _io_async_buffer(a, i);
+        a->iov[i] = (struct iovec){.iov_base = b->buf, .iov_len = _io_buffer_size(b)};
+    }
+    a->fixed = _io_uring_register(a->fd, IORING_REGISTER_BUFFERS, a->iov, nslots) == 0;
+
     return IO_ERR_OK;
 }
 
-IO_Err io_buffer_free(IO_Buffer *b) {
-    free(b->buf);
+IO_Err io_async_free(IO_Async *a) {
+    if (a->sqes != MAP_FAILED) munmap(a->sqes, a->sqes_sz);
+    if (a->cq_ring != MAP_FAILED && a->cq_ring != a->sq_ring) munmap(a->cq_ring, a->cq_ring_sz);
+    if (a->sq_ring != MAP_FAILED) munmap(a->sq_ring, a->sq_ring_sz);
+    if (a->fd >= 0) close(a->fd);
+    IO_FREE(a->readers);
+    IO_FREE(a->writers);
+    IO_FREE(a->inflight);
+    IO_FREE(a->active);
+    IO_FREE(a->iov);
+    a->fd = -1;
+    a->readers = NULL;
+    a->writers = NULL;
+    a->inflight = NULL;
+    a->active = NULL;
     return IO_ERR_OK;
 }
 
 /**
- * Returns physical size of the buffer.
+ * Queues an operation for slot `i` of engine `a`: a read into the free space
+ * of a reader's buffer or a write of the data buffered by a writer. Returns
+ * false if there is nothing to read into or to write.
  */
-static inline size_t _io_buffer_size(IO_Buffer *b) {
-    return b->cap + 1;
+static bool _io_async_prep(IO_Async *a, size_t i) {
+    bool read = i < a->nreaders;
+    IO_Buffer *b = _io_async_buffer(a, i);
+    IO_Span spans[2];
+    size_t nspans = read ? io_buffer_reserve_spans(b, spans) : io_buffer_peek_spans(b, spans);
+    if (nspans == 0) return false;
+
+    unsigned tail = *a->sq_tail;
+    unsigned idx = tail & *a->sq_mask;
+    struct io_uring_sqe *sqe = &a->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = read ? a->readers[i]->fd : a->writers[i - a->nreaders]->fd;
+    sqe->off = (__u64)-1;
+    sqe->user_data = i;
+
+    if (a->fixed) {
+        // NOTE: Fixed reads and writes are not vectored and must stay inside
+        //       the registered storage (which excludes the mirror of a
+        //       mirrored buffer), so only the first span is used.
+        size_t len = MIN(spans[0].len, (size_t)(b->buf + _io_buffer_size(b) - spans[0].ptr));
+        sqe->opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->addr = (__u64)(uintptr_t)spans[0].ptr;
+        sqe->len = len;
+        sqe->buf_index = i;
+    } else {
+        struct iovec *iov = &a->iov[2 * i];
+        for (size_t j = 0; j < nspans; j++) {
+            iov[j] = (struct iovec){.iov_base = spans[j].ptr, .iov_len = spans[j].len};
+        }
+        sqe->opcode = read ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe->addr = (__u64)(uintptr_t)iov;
+        sqe->len = nspans;
+    }
+
+    a->sq_array[idx] = idx;
+    __atomic_store_n(a->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    a->inflight[i] = true;
+    a->ninflight++;
+    return true;
 }
 
-size_t io_buffer_len(IO_Buffer *b) {
-    if (b->end >= b->start) return b->end - b->start;
-    return _io_buffer_size(b) - (b->start - b->buf) + (b->end - b->buf);
+IO_Err io_async_set_active(IO_Async *a, IO_Reader *r, bool active) {
+    for (size_t i = 0; i < a->nreaders; i++) {
+        if (a->readers[i] != r) continue;
+        a->active[i] = active;
+        return IO_ERR_OK;
+    }
+    return IO_ERR_OOB;
 }
 
-IO_Err io_buffer_reset(IO_Buffer *b) {
-    b->start = b->end;
-    return IO_ERR_OK;
+IO_Err io_async_set_writer_active(IO_Async *a, IO_Writer *w, bool active) {
+    for (size_t i = 0; i < a->nwriters; i++) {
+        if (a->writers[i] != w) continue;
+        a->active[a->nreaders + i] = active;
+        return IO_ERR_OK;
+    }
+    return IO_ERR_OOB;
 }
 
 /**
- * Returns the number of bytes between the later (farthest-from-`buf`) of
- * `b->start` and `b->end` and the physical end of the storage region.
- *
- * This is the length of the contiguous region available (or occupied) from
- * that pointer to the buffer's end; use it to determine how many bytes can be
- * read or written without wrapping back to `b->buf`.
- *
- * Example (8 bytes total, indices 0..7):
- *   case A: end >= start
- *     buf: |a|b|c|d|e|f|g|h|
- *             ^         ^
- *             start     end
- *     return value: distance from `end` to buffer end (1)
- *
- *   case B: end < start
- *     buf: |a|b|c|d|e|f|g|h|
- *             ^       ^
- *             end     start
- *     return value: distance from `start` to buffer end (2)
+ * Applies completion `cqe` of a read for the `i`-th reader of engine `a`.
  */
-static inline size_t _io_buffer_left_until_wrap(IO_Buffer *b) {
-    if (b->end >= b->start) return _io_buffer_size(b) - (b->end - b->buf);
-    return _io_buffer_size(b) - (b->start - b->buf);
+static IO_AsyncEvent _io_async_complete_read(IO_Async *a, size_t i, const struct io_uring_cqe *cqe) {
+    IO_Reader *r = a->readers[i];
+    IO_Err err = IO_ERR_OK;
+    if (cqe->res > 0) {
+        IO_ASSERT(io_reader_commit(r, cqe->res) == IO_ERR_OK);
+    } else if (cqe->res == 0) {
+        err = IO_ERR_EOF;
+    } else {
+        err = (cqe->res == -EAGAIN || cqe->res == -EWOULDBLOCK) ? IO_ERR_AGAIN : IO_ERR_FAILED_READ;
+    }
+    if (err == IO_ERR_EOF || err == IO_ERR_FAILED_READ) a->active[i] = false;
+#ifdef IO_STATS
+    r->stats.nreads++;
+    if (cqe->res > 0) r->stats.nbytes += cqe->res;
+    if (err == IO_ERR_EOF) r->stats.neof++;
+    if (err == IO_ERR_AGAIN) r->stats.nagain++;
+#endif // IO_STATS
+    return (IO_AsyncEvent){.r = r, .err = err};
 }
 
-size_t io_buffer_nadvance(IO_Buffer *b, size_t n) {
-    size_t len = io_buffer_len(b);
-    size_t to_shift = (n > len) ? len : n;
+/**
+ * Applies completion `cqe` of a write for the `i`-th writer of engine `a`.
+ */
+static IO_AsyncEvent _io_async_complete_write(IO_Async *a, size_t i, const struct io_uring_cqe *cqe) {
+    IO_Writer *w = a->writers[i];
+    IO_Err err = IO_ERR_OK;
+    if (cqe->res > 0) {
+        w->nflushed += io_buffer_nadvance(w->b, cqe->res);
+    } else if (cqe->res == -EAGAIN || cqe->res == -EWOULDBLOCK) {
+        err = IO_ERR_AGAIN;
+    } else {
+        err = IO_ERR_FAILED_WRITE;
+    }
+    if (err == IO_ERR_FAILED_WRITE) a->active[a->nreaders + i] = false;
+    return (IO_AsyncEvent){.w = w, .err = err};
+}
 
-    size_t cur_pos = b->start - b->buf;
-    size_t new_pos = (cur_pos + to_shift) % _io_buffer_size(b);
+size_t io_async_run(IO_Async *a, IO_AsyncEvent *events, size_t max, unsigned min_complete) {
+    unsigned to_submit = 0;
+    size_t nslots = a->nreaders + a->nwriters;
+    for (size_t i = 0; i < nslots && to_submit < a->sq_entries; i++) {
+        if (a->active[i] && !a->inflight[i] && _io_async_prep(a, i)) to_submit++;
+    }
 
-    b->start = b->buf + new_pos;
-    IO_ASSERT(b->start <= b->buf + b->cap && "Out of bounds");
+    // NOTE: Waiting for more completions than there are operations in flight
+    //       would block forever (e.g. when every buffer is full).
+    a->err = IO_ERR_OK;
+    min_complete = MIN(min_complete, a->ninflight);
+    unsigned flags = (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0;
+    if (to_submit > 0 || min_complete > 0) {
+        int res;
+        do res = _io_uring_enter(a->fd, to_submit, min_complete, flags); while (res < 0 && errno == EINTR);
+        if (res < 0) {
+            a->err = IO_ERR_FAILED_READ;
+            return 0;
+        }
+    }
 
-    return to_shift;
+    size_t nevents = 0;
+    unsigned head = *a->cq_head;
+    while (nevents < max && head != __atomic_load_n(a->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &a->cqes[head & *a->cq_mask];
+        size_t i = (size_t)cqe->user_data;
+        a->inflight[i] = false;
+        a->ninflight--;
+        events[nevents++] = (i < a->nreaders) ? _io_async_complete_read(a, i, cqe)
+                                              : _io_async_complete_write(a, i - a->nreaders, cqe);
+        head++;
+    }
+    __atomic_store_n(a->cq_head, head, __ATOMIC_RELEASE);
+
+    return nevents;
 }
+#endif // IO_URING && __linux__
 
-char io_buffer_at(IO_Buffer *b, size_t pos) {
-    size_t cur_pos = b->start - b->buf;
-    return b->buf[(cur_pos + pos) % _io_buffer_size(b)];
+#if defined(IO_LOOP_EPOLL) || defined(IO_LOOP_KQUEUE)
+#include <limits.h>
+#include <time.h>
+#ifdef IO_LOOP_EPOLL
+#  include <sys/epoll.h>
+#else
+#  include <sys/event.h>
+#endif
+
+enum {
+    _IO_CONN_WATCHED = 1 << 0,
+    _IO_CONN_PAUSED  = 1 << 1,
+};
+
+/**
+ * Returns the current time of the monotonic clock in milliseconds.
+ */
+static uint64_t _io_loop_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-IO_Err io_buffer_nspit(IO_Buffer *src, char *dest, size_t n) {
-    if (n == 0 || dest == NULL) return IO_ERR_OK;
-    if (n > io_buffer_len(src)) return IO_ERR_OOB;
+IO_Err io_loop_init(IO_Loop *l) {
+#ifdef IO_LOOP_EPOLL
+    l->fd = epoll_create1(EPOLL_CLOEXEC);
+    l->events = IO_MALLOC(IO_LOOP_MAX_EVENTS * sizeof(struct epoll_event));
+#else
+    l->fd = kqueue();
+    l->events = IO_MALLOC(IO_LOOP_MAX_EVENTS * sizeof(struct kevent));
+#endif
+    l->nevents = l->cur = 0;
+    l->current = NULL;
+    l->timers = NULL;
+    l->ntimers = l->timers_cap = 0;
+    l->stop = false;
+    if (l->fd < 0 || l->events == NULL) {
+        io_loop_free(l);
+        return (l->fd < 0) ? IO_ERR_UNSUPPORTED : IO_ERR_OOM;
+    }
+    return IO_ERR_OK;
+}
 
-    if (src->end >= src->start) {
-        memcpy(dest, src->start, n);
-        return IO_ERR_OK;
+IO_Err io_loop_free(IO_Loop *l) {
+    if (l->fd >= 0) close(l->fd);
+    IO_FREE(l->events);
+    IO_FREE(l->timers);
+    l->events = NULL;
+    l->timers = NULL;
+    return IO_ERR_OK;
+}
+
+/**
+ * Returns the file descriptor watched for connection `c`.
+ */
+static inline int _io_loop_conn_fd(IO_Conn *c) {
+    return (c->r != NULL) ? c->r->fd : c->fd;
+}
+
+IO_Err io_loop_add(IO_Loop *l, IO_Conn *c) {
+    int fd = _io_loop_conn_fd(c);
+#ifdef IO_LOOP_EPOLL
+    struct epoll_event ev = {.events = EPOLLIN | EPOLLRDHUP | EPOLLET, .data.ptr = c};
+    if (c->w != NULL) ev.events |= EPOLLOUT;
+    if (epoll_ctl(l->fd, EPOLL_CTL_ADD, fd, &ev) != 0) return IO_ERR_UNSUPPORTED;
+#else
+    struct kevent ev[2];
+    int nev = 0;
+    EV_SET(&ev[nev++], fd, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, c);
+    if (c->w != NULL) EV_SET(&ev[nev++], fd, EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0, c);
+    if (kevent(l->fd, ev, nev, NULL, 0, NULL) != 0) return IO_ERR_UNSUPPORTED;
+#endif
+    c->state = _IO_CONN_WATCHED;
+    return IO_ERR_OK;
+}
+
+IO_Err io_loop_remove(IO_Loop *l, IO_Conn *c) {
+    if (!(c->state & _IO_CONN_WATCHED)) return IO_ERR_OK;
+    int fd = _io_loop_conn_fd(c);
+#ifdef IO_LOOP_EPOLL
+    epoll_ctl(l->fd, EPOLL_CTL_DEL, fd, NULL);
+    struct epoll_event *events = l->events;
+    for (int i = l->cur + 1; i < l->nevents; i++) {
+        if (events[i].data.ptr == c) events[i].data.ptr = NULL;
+    }
+#else
+    struct kevent ev[2];
+    int nev = 0;
+    EV_SET(&ev[nev++], fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    if (c->w != NULL) EV_SET(&ev[nev++], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(l->fd, ev, nev, NULL, 0, NULL);
+    struct kevent *events = l->events;
+    for (int i = l->cur + 1; i < l->nevents; i++) {
+        if (events[i].udata == (void *)c) events[i].udata = NULL;
+    }
+#endif
+    if (l->current == c) l->current = NULL;
+    c->state = 0;
+    return IO_ERR_OK;
+}
+
+/**
+ * Removes connection `c` from event loop `l` and reports error `err` to it.
+ */
+static void _io_loop_close(IO_Loop *l, IO_Conn *c, IO_Err err) {
+    io_loop_remove(l, c);
+    if (c->on_close != NULL) c->on_close(l, c, err);
+}
+
+/**
+ * Returns true if IO buffer `b` is growable and below its `max_cap`.
+ */
+static inline bool _io_loop_can_grow(const IO_Buffer *b) {
+    return (b->flags & IO_BUFFER_GROWABLE) && b->cap < b->max_cap;
+}
+
+/**
+ * Reads from connection `c` of event loop `l` until it would block or its
+ * buffer is full and can't grow, passing the buffered data to `on_data`
+ * after every read (and right away if `deliver` is set). Returns false if
+ * the connection was removed, in which case it must not be touched anymore.
+ */
+static bool _io_loop_readable(IO_Loop *l, IO_Conn *c, bool deliver) {
+    IO_Reader *r = c->r;
+    l->current = c;
+    if (r == NULL) {
+        c->on_data(l, c, NULL, 0);
+        return l->current == c;
     }
+    for (;;) {
+        size_t nread = r->nread;
+        // NOTE: A full growable buffer grows (up to `max_cap`) before the
+        //       connection gets paused.
+        IO_Buffer *b = r->b;
+        if (io_reader_buffered(r) == b->cap && _io_loop_can_grow(b)) {
+            IO_Err err = io_buffer_reserve(b, MIN(b->cap, b->max_cap - b->cap));
+            if (err != IO_ERR_OK) {
+                _io_loop_close(l, c, err);
+                return false;
+            }
+        }
+        size_t space = b->cap - io_reader_buffered(r);
+        IO_Err err = (space > 0) ? io_reader_fill(r, space) : IO_ERR_OK;
 
-    size_t to_copy = MIN(_io_buffer_left_until_wrap(src), n);
-    memcpy(dest, src->start, to_copy);
-    if (n > to_copy) {
-        memcpy(dest + to_copy, src->buf, n-to_copy);
+        IO_Span spans[2];
+        size_t nspans = io_buffer_peek_spans(r->b, spans);
+        if (nspans > 0 && (deliver || r->nread > nread)) {
+            size_t consumed = c->on_data(l, c, spans, nspans);
+            if (l->current != c) return false;
+            io_reader_nconsume(r, NULL, consumed);
+        }
+        deliver = false;
+
+        if (err == IO_ERR_AGAIN) {
+            // NOTE: Idle connections give pooled storage back until the next
+            //       readiness event (see io_buffer_detach()).
+            io_buffer_detach(r->b);
+            return true;
+        }
+        if (err != IO_ERR_OK && err != IO_ERR_PARTIAL) {
+            _io_loop_close(l, c, err);
+            return false;
+        }
+        if (io_reader_buffered(r) == b->cap && !_io_loop_can_grow(b)) {
+            c->state |= _IO_CONN_PAUSED;
+            return true;
+        }
     }
+}
+
+/**
+ * Flushes the writer of connection `c` of event loop `l`, if any. Returns
+ * false if the connection was removed because of a failed write.
+ */
+static bool _io_loop_writable(IO_Loop *l, IO_Conn *c) {
+    if (c->w == NULL || io_writer_pending(c->w) == 0) return true;
+    IO_Err err = io_writer_flush(c->w);
+    if (err == IO_ERR_OK || err == IO_ERR_AGAIN) return true;
+    _io_loop_close(l, c, err);
+    return false;
+}
 
+IO_Err io_loop_resume(IO_Loop *l, IO_Conn *c) {
+    if (!(c->state & _IO_CONN_PAUSED)) return IO_ERR_OK;
+    c->state &= ~_IO_CONN_PAUSED;
+
+    // NOTE: Resuming may happen from the callback of another connection.
+    IO_Conn *current = l->current;
+    if (_io_loop_readable(l, c, true)) _io_loop_writable(l, c);
+    l->current = current;
     return IO_ERR_OK;
 }
 
-IO_Err io_buffer_append(IO_Buffer *dest, char *src, size_t n) {
-    if (n == 0) return IO_ERR_OK;
+/**
+ * Swaps the timers at positions `i` and `j` of the timer heap of event loop
+ * `l`.
+ */
+static inline void _io_loop_timer_swap(IO_Loop *l, size_t i, size_t j) {
+    IO_Timer *t = l->timers[i];
+    l->timers[i] = l->timers[j];
+    l->timers[j] = t;
+    l->timers[i]->idx = i + 1;
+    l->timers[j]->idx = j + 1;
+}
 
-    size_t len = io_buffer_len(dest);
-    size_t space_left = dest->cap - len;
-    if (n > space_left) return IO_ERR_OOB;
+/**
+ * Restores the heap order of the timers of event loop `l` after the timer at
+ * position `i` changed.
+ */
+static void _io_loop_timer_fix(IO_Loop *l, size_t i) {
+    while (i > 0 && l->timers[(i - 1) / 2]->deadline > l->timers[i]->deadline) {
+        _io_loop_timer_swap(l, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    for (;;) {
+        size_t min = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < l->ntimers && l->timers[left]->deadline < l->timers[min]->deadline) min = left;
+        if (right < l->ntimers && l->timers[right]->deadline < l->timers[min]->deadline) min = right;
+        if (min == i) return;
+        _io_loop_timer_swap(l, i, min);
+        i = min;
+    }
+}
 
-    if (dest->start > dest->end) {
-        memcpy(dest->end, src, n);
-        dest->end += n;
+IO_Err io_loop_add_timer(IO_Loop *l, IO_Timer *t, uint64_t ms) {
+    t->deadline = _io_loop_now() + ms;
+    if (t->idx > 0) {
+        _io_loop_timer_fix(l, t->idx - 1);
         return IO_ERR_OK;
     }
 
-    size_t to_copy = MIN(_io_buffer_left_until_wrap(dest), n);
-    memcpy(dest->end, src, to_copy);
-    dest->end += to_copy;
-    if (dest->end == dest->buf + _io_buffer_size(dest)) dest->end = dest->buf;
-    n -= to_copy;
+    if (l->ntimers == l->timers_cap) {
+        size_t cap = MAX(l->timers_cap * 2, 16);
+        IO_Timer **timers = IO_REALLOC(l->timers, cap * sizeof(*timers));
+        if (timers == NULL) return IO_ERR_OOM;
+        l->timers = timers;
+        l->timers_cap = cap;
+    }
+    l->timers[l->ntimers] = t;
+    t->idx = ++l->ntimers;
+    _io_loop_timer_fix(l, t->idx - 1);
+    return IO_ERR_OK;
+}
 
-    if (n > 0) {
-        memcpy(dest->end, src + to_copy, n);
-        dest->end += n;
+IO_Err io_loop_cancel_timer(IO_Loop *l, IO_Timer *t) {
+    if (t->idx == 0) return IO_ERR_OK;
+    size_t i = t->idx - 1;
+    _io_loop_timer_swap(l, i, --l->ntimers);
+    t->idx = 0;
+    if (i < l->ntimers) _io_loop_timer_fix(l, i);
+    return IO_ERR_OK;
+}
+
+IO_Err io_loop_run_once(IO_Loop *l, int timeout) {
+    if (l->ntimers > 0) {
+        uint64_t now = _io_loop_now(), deadline = l->timers[0]->deadline;
+        int until = (deadline > now) ? (int)MIN(deadline - now, (uint64_t)INT_MAX) : 0;
+        if (timeout < 0 || until < timeout) timeout = until;
     }
 
-    IO_ASSERT(dest->end <= dest->buf + _io_buffer_size(dest) && "Out of bounds");
+#ifdef IO_LOOP_EPOLL
+    struct epoll_event *events = l->events;
+    int n = epoll_wait(l->fd, events, IO_LOOP_MAX_EVENTS, timeout);
+#else
+    struct kevent *events = l->events;
+    struct timespec ts = {.tv_sec = timeout / 1000, .tv_nsec = (long)(timeout % 1000) * 1000000};
+    int n = kevent(l->fd, NULL, 0, events, IO_LOOP_MAX_EVENTS, (timeout < 0) ? NULL : &ts);
+#endif
+    if (n < 0 && errno != EINTR) return IO_ERR_FAILED_READ;
+
+    l->nevents = MAX(n, 0);
+    for (l->cur = 0; l->cur < l->nevents; l->cur++) {
+#ifdef IO_LOOP_EPOLL
+        IO_Conn *c = events[l->cur].data.ptr;
+        if (c == NULL) continue;
+        uint32_t flags = events[l->cur].events;
+        if ((flags & EPOLLOUT) && !_io_loop_writable(l, c)) continue;
+        if (!(flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) continue;
+#else
+        IO_Conn *c = (IO_Conn *)events[l->cur].udata;
+        if (c == NULL) continue;
+        if (events[l->cur].flags & EV_ERROR) {
+            _io_loop_close(l, c, IO_ERR_FAILED_READ);
+            continue;
+        }
+        if (events[l->cur].filter == EVFILT_WRITE) {
+            _io_loop_writable(l, c);
+            continue;
+        }
+#endif
+        if (c->state & _IO_CONN_PAUSED) continue;
+        if (_io_loop_readable(l, c, false)) _io_loop_writable(l, c);
+    }
+    l->nevents = l->cur = 0;
 
+    uint64_t now = _io_loop_now();
+    while (l->ntimers > 0 && l->timers[0]->deadline <= now) {
+        IO_Timer *t = l->timers[0];
+        io_loop_cancel_timer(l, t);
+        t->cb(l, t);
+    }
     return IO_ERR_OK;
 }
 
-IO_Err io_reader_init(IO_Reader *r, IO_Buffer *b, int fd) {
-    r->b = b;
-    r->fd = fd;
-    r->pos = r->nread = 0;
+IO_Err io_loop_run(IO_Loop *l) {
+    l->stop = false;
+    while (!l->stop) {
+        IO_Err err = io_loop_run_once(l, -1);
+        if (err != IO_ERR_OK) return err;
+    }
     return IO_ERR_OK;
 }
 
-size_t io_reader_buffered(IO_Reader *r) {
-    IO_ASSERT(r->nread >= r->pos && r->nread - r->pos == io_buffer_len(r->b) && "Out of bounds");
-    return r->nread - r->pos;
+IO_Err io_loop_stop(IO_Loop *l) {
+    l->stop = true;
+    return IO_ERR_OK;
 }
 
-IO_Err io_reader_npeek(IO_Reader *r, char *dest, size_t n) {
-    if (n == 0) return IO_ERR_OK;
-    if (n > r->b->cap) return IO_ERR_OOB;
+#ifdef IO_SERVER
 
-    size_t buffered = io_reader_buffered(r);
-    if (buffered == 0) {
-        int nread = IO_READ(r->fd, dest, n);
-        if (nread < 0) return IO_ERR_FAILED_READ;
-        if (nread == 0) return IO_ERR_EOF;
-        IO_ASSERT(io_buffer_append(r->b, dest, nread) == IO_ERR_OK);
-        r->nread += nread;
-        if ((size_t)nread < n) return IO_ERR_PARTIAL;
-        return IO_ERR_OK;
+/**
+ * Creates a non-blocking socket listening on address `addr` (of `addrlen`
+ * bytes) that shares the address with other such sockets. Returns -1 on
+ * failure.
+ */
+static int _io_server_listen(const struct sockaddr *addr, socklen_t addrlen) {
+#ifdef SO_REUSEPORT
+    int fd = socket(addr->sa_family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0 ||
+        bind(fd, addr, addrlen) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
     }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+#else
+    (void)addr;
+    (void)addrlen;
+    return -1;
+#endif // SO_REUSEPORT
+}
 
-    size_t to_copy = MIN(buffered, n);
-    IO_ASSERT(io_buffer_nspit(r->b, dest, to_copy) == IO_ERR_OK);
-    if (to_copy < n) return IO_ERR_PARTIAL;
-    return IO_ERR_OK;
+/**
+ * Accepts connections on the listening socket of a worker until it would
+ * block and hands them over to `on_accept`.
+ */
+static size_t _io_server_accept(IO_Loop *l, IO_Conn *c, const IO_Span *spans, size_t nspans) {
+    (void)l;
+    (void)spans;
+    (void)nspans;
+    IO_Worker *w = c->ctx;
+    int fd;
+    while ((fd = accept(c->fd, NULL, NULL)) >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        w->server->cfg.on_accept(w, fd);
+    }
+    return 0;
 }
 
-IO_Err io_reader_prefetch(IO_Reader *r, size_t n) {
-    char *tmp = IO_MALLOC(n);
-    if (tmp == NULL) return IO_ERR_OOM;
-    IO_Err res = io_reader_npeek(r, tmp, n);
-    free(tmp);
-    return res;
+/**
+ * Stops the loop of a worker once io_server_stop() wrote into its wakeup
+ * pipe.
+ */
+static size_t _io_server_wakeup(IO_Loop *l, IO_Conn *c, const IO_Span *spans, size_t nspans) {
+    (void)spans;
+    (void)nspans;
+    char drain[16];
+    while (read(c->fd, drain, sizeof(drain)) > 0) {}
+    io_loop_stop(l);
+    return 0;
 }
 
-IO_Err io_reader_nconsume(IO_Reader *r, char *dest, size_t n) {
-    if (n == 0) return IO_ERR_OK;
+IO_Err io_server_init(IO_Server *s, const IO_ServerConfig *cfg) {
+    s->cfg = *cfg;
+    s->nworkers = 0;
+    if (cfg->addrlen > sizeof(s->addr)) return IO_ERR_OOB;
+    memcpy(&s->addr, cfg->addr, cfg->addrlen);
 
-    size_t to_copy = MIN(n, io_buffer_len(r->b));
-    if (dest != NULL) IO_ASSERT(io_buffer_nspit(r->b, dest, to_copy) == IO_ERR_OK);
-    io_buffer_nadvance(r->b, to_copy);
-    r->pos += to_copy;
+    size_t n = cfg->nworkers;
+    if (n == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        n = (ncpu > 0) ? (size_t)ncpu : 1;
+    }
+    s->workers = IO_MALLOC(n * sizeof(*s->workers));
+    if (s->workers == NULL) return IO_ERR_OOM;
 
-    IO_ASSERT(r->pos <= r->nread && "Out of bounds");
+    socklen_t addrlen = cfg->addrlen;
+    for (size_t i = 0; i < n; i++) {
+        IO_Worker *w = &s->workers[i];
+        int fd = _io_server_listen((struct sockaddr *)&s->addr, addrlen);
+        if (fd < 0) {
+            io_server_free(s);
+            return IO_ERR_UNSUPPORTED;
+        }
+        // NOTE: Resolves an ephemeral port for the next listeners.
+        if (i == 0) getsockname(fd, (struct sockaddr *)&s->addr, &addrlen);
+
+        if (pipe(w->wakeup_fds) != 0) {
+            close(fd);
+            io_server_free(s);
+            return IO_ERR_OOM;
+        }
+        fcntl(w->wakeup_fds[0], F_SETFL, O_NONBLOCK);
+
+        w->listener = (IO_Conn){.fd = fd, .on_data = _io_server_accept, .ctx = w};
+        w->wakeup = (IO_Conn){.fd = w->wakeup_fds[0], .on_data = _io_server_wakeup, .ctx = w};
+        w->index = i;
+        w->server = s;
+        w->err = IO_ERR_OK;
+        s->nworkers++;
+    }
     return IO_ERR_OK;
 }
 
-IO_Err io_reader_discard(IO_Reader *r) {
-    r->pos += io_buffer_len(r->b);
-    io_buffer_reset(r->b);
-
-    IO_ASSERT(r->pos == r->nread && "Out of bounds");
+/**
+ * Pins the calling thread to CPU `cpu`.
+ */
+static IO_Err _io_server_pin(size_t cpu) {
+#if defined(__linux__) && defined(__NR_sched_setaffinity)
+    // NOTE: CPU_SET() and friends are only declared with _GNU_SOURCE, so the
+    //       mask is built and the system call is made directly.
+    enum { MAX_CPUS = 1024, BITS = 8 * sizeof(unsigned long) };
+    if (cpu >= MAX_CPUS) return IO_ERR_OOB;
+    unsigned long mask[MAX_CPUS / BITS] = {0};
+    mask[cpu / BITS] |= 1UL << (cpu % BITS);
+    if (syscall(__NR_sched_setaffinity, 0, sizeof(mask), mask) != 0) return IO_ERR_UNSUPPORTED;
     return IO_ERR_OK;
+#else
+    (void)cpu;
+    return IO_ERR_OK;
+#endif // defined(__linux__) && defined(__NR_sched_setaffinity)
 }
 
-IO_Err io_reader_nread(IO_Reader *r, char *dest, size_t n) {
-    if (n == 0) return IO_ERR_OK;
+/**
+ * Thread routine of worker `arg`: pins it, sets up its pool and loop on the
+ * worker's own thread and runs the loop until it is stopped.
+ *
+ * If pinning was requested but failed, the worker does not start and stops
+ * the whole server.
+ */
+static void *_io_server_worker(void *arg) {
+    IO_Worker *w = arg;
+    IO_ServerConfig *cfg = &w->server->cfg;
+    if (cfg->pin) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        w->err = _io_server_pin(w->index % (size_t)MAX(ncpu, 1));
+        if (w->err != IO_ERR_OK) {
+            io_server_stop(w->server);
+            return NULL;
+        }
+    }
 
-    size_t start_pos = r->pos;
-    IO_ASSERT(io_reader_nconsume(r, dest, n) == IO_ERR_OK);
-    size_t copied = r->pos - start_pos;
+    w->err = io_buffer_pool_init(&w->pool, cfg->buffer_cap, MAX(cfg->pool_blocks, 1));
+    if (w->err != IO_ERR_OK) return NULL;
+    w->err = io_loop_init(&w->loop);
+    if (w->err != IO_ERR_OK) {
+        io_buffer_pool_free(&w->pool);
+        return NULL;
+    }
 
-    size_t to_read = n - copied;
-    if (to_read > 0) {
-        int nread = IO_READ(r->fd, dest + copied, to_read);
-        if (nread < 0) return IO_ERR_FAILED_READ;
-        if (nread == 0 && copied == 0) return IO_ERR_EOF;
+    w->err = io_loop_add(&w->loop, &w->wakeup);
+    if (w->err == IO_ERR_OK) w->err = io_loop_add(&w->loop, &w->listener);
+    if (w->err == IO_ERR_OK) w->err = io_loop_run(&w->loop);
+    if (cfg->on_stop != NULL) cfg->on_stop(w);
 
-        r->pos += nread;
-        r->nread += nread;
+    io_loop_free(&w->loop);
+    io_buffer_pool_free(&w->pool);
+    return NULL;
+}
+
+IO_Err io_server_run(IO_Server *s) {
+    size_t started = 0;
+    IO_Err err = IO_ERR_OK;
+    for (; started < s->nworkers; started++) {
+        IO_Worker *w = &s->workers[started];
+        if (pthread_create(&w->thread, NULL, _io_server_worker, w) != 0) {
+            io_server_stop(s);
+            err = IO_ERR_OOM;
+            break;
+        }
     }
-    
-    IO_ASSERT(r->pos <= r->nread && "Out of bounds");
-    if (start_pos + n > r->pos) return IO_ERR_PARTIAL;
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(s->workers[i].thread, NULL);
+        if (err == IO_ERR_OK) err = s->workers[i].err;
+    }
+    return err;
+}
+
+IO_Err io_server_stop(IO_Server *s) {
+    for (size_t i = 0; i < s->nworkers; i++) {
+        ssize_t res;
+        do res = write(s->workers[i].wakeup_fds[1], "", 1); while (res < 0 && errno == EINTR);
+    }
+    return IO_ERR_OK;
+}
+
+IO_Err io_server_free(IO_Server *s) {
+    for (size_t i = 0; i < s->nworkers; i++) {
+        close(s->workers[i].listener.fd);
+        close(s->workers[i].wakeup_fds[0]);
+        close(s->workers[i].wakeup_fds[1]);
+    }
+    IO_FREE(s->workers);
+    s->workers = NULL;
+    s->nworkers = 0;
     return IO_ERR_OK;
 }
+#endif // IO_SERVER
+#endif // IO_LOOP_EPOLL || IO_LOOP_KQUEUE
 
 #  endif // IO_IMPL_GUARD
 #endif // IO_IMPL
@@ -1,3 +1,4 @@
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -79,6 +80,20 @@ int t_new_pipe_with_data(const char *data, size_t n) {
     return fds[0];
 }
 
+/**
+ * Creates a temporary regular file filled with given data and returns fd for
+ * reading it from the beginning. The file is unlinked right away.
+ */
+int t_new_file_with_data(const char *data, size_t n) {
+    char path[] = "/tmp/io_h_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) T_FATAL("Failed to create temporary file");
+    unlink(path);
+    if (write(fd, data, n) != (ssize_t)n) T_FATAL("Failed to write temporary file");
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
 char *t_reader_repr(IO_Reader *r) {
     static char repr[T_STATIC_MEMORY_SZ] = {0};
     sprintf(repr, "IO_Reader (at %p): b=%s; nread=%zu; pos=%zu; fd=%d;",
@@ -88,3 +103,41 @@ char *t_reader_repr(IO_Reader *r) {
 
 #define T_READER_WITH_DATA(cap, data, n) (t_new_reader((cap), t_new_pipe_with_data((data), (n))))
 #define T_READER_FREE(r) ({io_buffer_free((r)->b); close((r)->fd);})
+
+/**
+ * Creates and initializes a new writer with buffer of capacity `cap` writing
+ * into a new pipe. The pipe's file descriptors are stored in `fds`; the
+ * reading side is non-blocking.
+ */
+IO_Writer t_new_writer_with_pipe(size_t cap, int fds[2]) {
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Buffer *b = malloc(sizeof(IO_Buffer));
+    if (io_buffer_init(b, cap) != IO_ERR_OK) T_FATAL("Failed to initialize buffer");
+    IO_Writer w = {0};
+    io_writer_init(&w, b, fds[1]);
+    return w;
+}
+
+char *t_writer_repr(IO_Writer *w) {
+    static char repr[T_STATIC_MEMORY_SZ] = {0};
+    sprintf(repr, "IO_Writer (at %p): b=%s; nwritten=%zu; nflushed=%zu; fd=%d;",
+            w, t_buffer_repr(w->b), w->nwritten, w->nflushed, w->fd);
+    return repr;
+}
+
+#define T_WRITER_FREE(w, fds) ({io_buffer_free((w)->b); close((fds)[0]); close((fds)[1]);})
+
+/**
+ * Reads everything currently available from the non-blocking `fd` into
+ * `dest` and returns the number of bytes read.
+ */
+size_t t_drain(int fd, char *dest, size_t cap) {
+    size_t total = 0;
+    for (;;) {
+        ssize_t n = read(fd, dest + total, cap - total);
+        if (n <= 0) break;
+        total += n;
+    }
+    return total;
+}
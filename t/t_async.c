@@ -0,0 +1,228 @@
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_IMPL
+#define IO_URING
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_ASYNC_PASSED = 0, T_ASYNC_FAILED = 0;
+
+/**
+ * Initializes engine `a` for `nr` readers and `nw` writers. Returns false if
+ * io_uring is not available in this environment, so the test case can be
+ * skipped.
+ */
+bool t_async_init_rw(IO_Async *a, IO_Reader **readers, size_t nr, IO_Writer **writers, size_t nw) {
+    IO_Err err = io_async_init_rw(a, readers, nr, writers, nw);
+    if (err == IO_ERR_UNSUPPORTED) {
+        printf("INFO: io_uring is not available, skipping\n");
+        return false;
+    }
+    if (err != IO_ERR_OK) T_FATAL("Failed to initialize engine: %s\n", io_err_to_cstr(err));
+    return true;
+}
+
+bool t_async_init(IO_Async *a, IO_Reader **readers, size_t n) {
+    return t_async_init_rw(a, readers, n, NULL, 0);
+}
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_async_case_reads_into_many_readers(void) {
+    bool passed = true;
+    IO_Reader r1 = T_READER_WITH_DATA(8, "HELLO", 5);
+    IO_Reader r2 = T_READER_WITH_DATA(8, "WORLD!", 6);
+    IO_Reader *readers[] = {&r1, &r2};
+
+    IO_Async a;
+    if (!t_async_init(&a, readers, 2)) goto skip;
+
+    IO_AsyncEvent events[4];
+    size_t got = 0;
+    while (got < 2) got += io_async_run(&a, events + got, 4 - got, 1);
+    T_ASSERT(got == 2);
+    for (size_t i = 0; i < got; i++) T_ASSERT(events[i].err == IO_ERR_OK);
+
+    T_ASSERT(r1.nread == 5 && r1.pos == 0);
+    T_ASSERT(r2.nread == 6 && r2.pos == 0);
+    char dest[8] = {0};
+    T_ASSERT(io_buffer_nspit(r1.b, dest, 5) == IO_ERR_OK && strncmp(dest, "HELLO", 5) == 0);
+    T_ASSERT(io_buffer_nspit(r2.b, dest, 6) == IO_ERR_OK && strncmp(dest, "WORLD!", 6) == 0);
+
+    got = 0;
+    while (got < 2) got += io_async_run(&a, events + got, 4 - got, 1);
+    for (size_t i = 0; i < got; i++) T_ASSERT(events[i].err == IO_ERR_EOF);
+
+    io_async_free(&a);
+skip:
+    T_READER_FREE(&r1);
+    T_READER_FREE(&r2);
+    return passed;
+}
+
+bool t_async_case_full_buffer_is_not_read_into(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(4, "ABCDEF", 6);
+    IO_Reader *readers[] = {&r};
+
+    IO_Async a;
+    if (!t_async_init(&a, readers, 1)) goto skip;
+
+    IO_AsyncEvent events[1];
+    T_ASSERT(io_async_run(&a, events, 1, 1) == 1);
+    T_ASSERT(events[0].err == IO_ERR_OK && r.nread == 4);
+    T_ASSERT(io_async_run(&a, events, 1, 0) == 0);
+    T_ASSERT(io_async_run(&a, events, 1, 1) == 0);
+    T_ASSERT(a.err == IO_ERR_OK && a.ninflight == 0);
+
+    T_ASSERT(io_reader_nconsume(&r, NULL, 4) == IO_ERR_OK);
+    T_ASSERT(io_async_run(&a, events, 1, 1) == 1);
+    T_ASSERT(events[0].err == IO_ERR_OK && r.nread == 6);
+    T_ASSERT(io_buffer_len(r.b) == 2);
+
+    io_async_free(&a);
+skip:
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_async_case_closed_peer_is_not_read_again(void) {
+    bool passed = true;
+    IO_Reader r1 = T_READER_WITH_DATA(8, "HELLO", 5);
+    IO_Reader r2 = T_READER_WITH_DATA(8, "", 0);
+    IO_Reader other = T_READER_WITH_DATA(8, "", 0);
+    IO_Reader *readers[] = {&r1, &r2};
+
+    IO_Async a;
+    if (!t_async_init(&a, readers, 2)) goto skip;
+
+    IO_AsyncEvent events[4];
+    size_t got = 0, neof = 0;
+    while (neof < 2) {
+        got = io_async_run(&a, events, 4, 1);
+        T_ASSERT(got > 0);
+        for (size_t i = 0; i < got; i++) if (events[i].err == IO_ERR_EOF) neof++;
+    }
+    T_ASSERT(neof == 2 && r1.nread == 5);
+    T_ASSERT(io_async_run(&a, events, 4, 1) == 0);
+    T_ASSERT(a.err == IO_ERR_OK && a.ninflight == 0);
+
+    T_ASSERT(io_async_set_active(&a, &other, true) == IO_ERR_OOB);
+    T_ASSERT(io_async_set_active(&a, &r2, true) == IO_ERR_OK);
+    T_ASSERT(io_async_run(&a, events, 4, 1) == 1);
+    T_ASSERT(events[0].r == &r2 && events[0].err == IO_ERR_EOF);
+    T_ASSERT(io_async_run(&a, events, 4, 1) == 0);
+
+    io_async_free(&a);
+skip:
+    T_READER_FREE(&r1);
+    T_READER_FREE(&r2);
+    T_READER_FREE(&other);
+    return passed;
+}
+
+bool t_async_case_writes_and_reads_in_one_batch(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "PING", 4);
+    int fds[2];
+    IO_Writer w = t_new_writer_with_pipe(8, fds);
+    T_ASSERT(io_writer_write(&w, "PONG", 4) == IO_ERR_OK && io_writer_pending(&w) == 4);
+    IO_Reader *readers[] = {&r};
+    IO_Writer *writers[] = {&w};
+
+    IO_Async a;
+    if (!t_async_init_rw(&a, readers, 1, writers, 1)) goto skip;
+
+    IO_AsyncEvent events[4];
+    size_t got = 0;
+    while (got < 2) got += io_async_run(&a, events + got, 4 - got, 1);
+    T_ASSERT(got == 2);
+    for (size_t i = 0; i < got; i++) {
+        T_ASSERT(events[i].err == IO_ERR_OK);
+        T_ASSERT((events[i].r == &r && events[i].w == NULL) || (events[i].r == NULL && events[i].w == &w));
+    }
+    T_ASSERT(r.nread == 4 && io_reader_buffered(&r) == 4);
+    T_ASSERT(io_writer_pending(&w) == 0 && w.nflushed == 4);
+    char dest[8] = {0};
+    T_ASSERT(t_drain(fds[0], dest, sizeof(dest)) == 4 && memcmp(dest, "PONG", 4) == 0);
+
+    // NOTE: Nothing is written while the writer has nothing buffered.
+    T_ASSERT(io_reader_nconsume(&r, NULL, 4) == IO_ERR_OK);
+    T_ASSERT(io_async_run(&a, events, 4, 1) == 1 && events[0].r == &r && events[0].err == IO_ERR_EOF);
+    T_ASSERT(io_async_run(&a, events, 4, 1) == 0);
+
+    io_async_free(&a);
+skip:
+    T_READER_FREE(&r);
+    T_WRITER_FREE(&w, fds);
+    return passed;
+}
+
+bool t_async_case_writes_wrapped_data_and_stops_on_failure(void) {
+    bool passed = true;
+    int fds[2];
+    IO_Writer w = t_new_writer_with_pipe(8, fds);
+    IO_Writer *writers[] = {&w};
+    T_ASSERT(io_buffer_append(w.b, "xxxxxx", 6) == IO_ERR_OK && io_buffer_nadvance(w.b, 6) == 6);
+    T_ASSERT(io_writer_write(&w, "ABCDEFG", 7) == IO_ERR_OK);
+    IO_Span spans[2];
+    T_ASSERT(io_buffer_peek_spans(w.b, spans) == 2);
+
+    IO_Async a;
+    if (!t_async_init_rw(&a, NULL, 0, writers, 1)) goto skip;
+
+    IO_AsyncEvent events[2];
+    while (io_writer_pending(&w) > 0) {
+        T_ASSERT(io_async_run(&a, events, 2, 1) == 1);
+        T_ASSERT(events[0].w == &w && events[0].err == IO_ERR_OK);
+    }
+    char dest[8] = {0};
+    T_ASSERT(t_drain(fds[0], dest, sizeof(dest)) == 7 && memcmp(dest, "ABCDEFG", 7) == 0);
+
+    close(fds[0]);
+    fds[0] = -1;
+    void (*prev)(int) = signal(SIGPIPE, SIG_IGN);
+    T_ASSERT(io_writer_write(&w, "OOPS", 4) == IO_ERR_OK);
+    T_ASSERT(io_async_run(&a, events, 2, 1) == 1);
+    T_ASSERT(events[0].w == &w && events[0].err == IO_ERR_FAILED_WRITE);
+    T_ASSERT(io_async_run(&a, events, 2, 1) == 0);
+    T_ASSERT(io_writer_pending(&w) == 4);
+    signal(SIGPIPE, prev);
+
+    T_ASSERT(io_async_set_writer_active(&a, &w, false) == IO_ERR_OK);
+    T_ASSERT(io_async_set_active(&a, NULL, true) == IO_ERR_OOB);
+
+    io_async_free(&a);
+skip:
+    T_WRITER_FREE(&w, fds);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_ASYNC_CASE_MAP(XX)                                        \
+    XX(1,  reads_into_many_readers)                                 \
+    XX(2,  full_buffer_is_not_read_into)                            \
+    XX(3,  closed_peer_is_not_read_again)                           \
+    XX(4,  writes_and_reads_in_one_batch)                           \
+    XX(5,  writes_wrapped_data_and_stops_on_failure)
+
+void t_async_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_async_case_##name();                            \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_ASYNC_PASSED++; else T_ASYNC_FAILED++;            \
+    } while(0);
+
+    T_ASYNC_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_ASYNC_PASSED, T_ASYNC_PASSED + T_ASYNC_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_async_run();
+    return 0;
+}
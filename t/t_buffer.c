@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -385,6 +386,382 @@ bool t_buffer_case_nadvance_beyond_capacity(void) {
 
     return passed;
 }
+bool t_buffer_case_at_across_wrap(void) {
+    bool passed = true;
+
+    char *raw = malloc(7);
+    raw[0] = 'C';
+    raw[1] = 'D';
+    raw[2] = '\0';
+    raw[3] = '\0';
+    raw[4] = '\0';
+    raw[5] = 'A';
+    raw[6] = 'B';
+    IO_Buffer b = {.cap=6, .buf=raw, .start=raw+5, .end=raw+2};
+
+    const char *exp = "ABCD";
+    for (size_t i = 0; i < 4; i++) T_ASSERT_FOR_BUFFER(io_buffer_at(&b, i) == exp[i], &b);
+
+    io_buffer_free(&b);
+
+    return passed;
+}
+bool t_buffer_case_mirrored_append_and_nspit_across_wrap(void) {
+    bool passed = true;
+
+    IO_Buffer b = {0};
+    IO_Err err = io_buffer_init_mirrored(&b, 6);
+    if (err == IO_ERR_UNSUPPORTED) return passed;
+    T_ASSERT(err == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(b.cap >= 6 && b.flags == IO_BUFFER_MIRRORED, &b);
+
+    size_t cap = b.cap;
+    b.start = b.end = b.buf + cap - 1;
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "ABCDEF", 6) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_len(&b) == 6, &b);
+    T_ASSERT_FOR_BUFFER(b.end == b.buf + 4, &b);
+    T_ASSERT_FOR_BUFFER(strncmp(b.start, "ABCDEF", 6) == 0, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_at(&b, 5) == 'F', &b);
+
+    char dest[6] = {0};
+    T_ASSERT(io_buffer_nspit(&b, dest, 6) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "ABCDEF", 6) == 0);
+
+    T_ASSERT(io_buffer_nadvance(&b, 4) == 4);
+    T_ASSERT_FOR_BUFFER(b.start == b.buf + 2, &b);
+    T_ASSERT_FOR_BUFFER(strncmp(b.start, "EF", 2) == 0, &b);
+
+    io_buffer_free(&b);
+
+    return passed;
+}
+bool t_buffer_case_peek_spans(void) {
+    bool passed = true;
+
+    IO_Span spans[2];
+    IO_Buffer b = T_EMPTY_BUFFER(6);
+    T_ASSERT_FOR_BUFFER(io_buffer_peek_spans(&b, spans) == 0, &b);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "1234", 4) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_peek_spans(&b, spans) == 1, &b);
+    T_ASSERT(spans[0].ptr == b.buf && spans[0].len == 4);
+
+    T_ASSERT(io_buffer_nadvance(&b, 3) == 3);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "5678", 4) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_peek_spans(&b, spans) == 2, &b);
+    T_ASSERT(spans[0].ptr == b.buf + 3 && spans[0].len == 4);
+    T_ASSERT(strncmp(spans[0].ptr, "4567", 4) == 0);
+    T_ASSERT(spans[1].ptr == b.buf && spans[1].len == 1);
+    T_ASSERT(strncmp(spans[1].ptr, "8", 1) == 0);
+
+    io_buffer_free(&b);
+
+    return passed;
+}
+
+bool t_buffer_case_reserve_spans_and_commit(void) {
+    bool passed = true;
+
+    IO_Span spans[2];
+    IO_Buffer b = T_EMPTY_BUFFER(6);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "1234", 4) == IO_ERR_OK, &b);
+    T_ASSERT(io_buffer_nadvance(&b, 3) == 3);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_reserve_spans(&b, spans) == 2, &b);
+    T_ASSERT(spans[0].ptr == b.buf + 4 && spans[0].len == 3);
+    T_ASSERT(spans[1].ptr == b.buf && spans[1].len == 2);
+
+    memcpy(spans[0].ptr, "ABC", 3);
+    memcpy(spans[1].ptr, "DE", 2);
+    T_ASSERT_FOR_BUFFER(io_buffer_commit(&b, 6) == IO_ERR_OOB, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_commit(&b, 5) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_len(&b) == 6, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_reserve_spans(&b, spans) == 0, &b);
+
+    char dest[6] = {0};
+    T_ASSERT(io_buffer_nspit(&b, dest, 6) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "4ABCDE", 6) == 0);
+
+    T_ASSERT(io_buffer_nadvance(&b, 6) == 6);
+    T_ASSERT_FOR_BUFFER(io_buffer_reserve_spans(&b, spans) == 1, &b);
+    T_ASSERT(spans[0].ptr == b.buf && spans[0].len == 6);
+
+    io_buffer_free(&b);
+
+    return passed;
+}
+bool t_buffer_case_find_across_wrap(void) {
+    bool passed = true;
+
+    char *raw = malloc(7);
+    memcpy(raw, "\nD\0\0AB\r", 7);
+    IO_Buffer b = {.cap=6, .buf=raw, .start=raw+4, .end=raw+2};
+
+    T_ASSERT_FOR_BUFFER(io_buffer_find_byte(&b, 0, 'B') == 1, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_byte(&b, 0, 'D') == 4, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_byte(&b, 2, 'B') == IO_NOT_FOUND, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_byte(&b, 0, '\0') == IO_NOT_FOUND, &b);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_find_any(&b, 0, "\r\n", 2) == 2, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_any(&b, 3, "\r\n", 2) == 3, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_any(&b, 4, "\r\n", 2) == IO_NOT_FOUND, &b);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_find(&b, 0, "\r\n", 2) == 2, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find(&b, 0, "B\r\nD", 4) == 1, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find(&b, 0, "D\r", 2) == IO_NOT_FOUND, &b);
+
+    io_buffer_free(&b);
+
+    return passed;
+}
+
+bool t_buffer_case_find_any_in_long_data(void) {
+    bool passed = true;
+
+    IO_Buffer b = T_EMPTY_BUFFER(128);
+    char data[100];
+    memset(data, 'x', sizeof(data));
+    data[70] = '\n';
+    data[90] = '\r';
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, data, sizeof(data)) == IO_ERR_OK, &b);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_find_any(&b, 0, "\r\n", 2) == 70, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_any(&b, 71, "\r\n", 2) == 90, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_any(&b, 0, "\r\n\t ;:", 6) == 70, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_find_any(&b, 91, "\r\n", 2) == IO_NOT_FOUND, &b);
+
+    io_buffer_free(&b);
+
+    return passed;
+}
+
+bool t_buffer_case_growable_append_grows_and_linearizes(void) {
+    bool passed = true;
+
+    IO_Buffer b = {0};
+    T_ASSERT(io_buffer_init_growable(&b, 8, 4) == IO_ERR_OOB);
+    T_ASSERT(io_buffer_init_growable(&b, 4, 32) == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "0123", 4) == IO_ERR_OK, &b);
+    T_ASSERT(io_buffer_nadvance(&b, 3) == 3);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "ABC", 3) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(b.cap == 4 && b.end < b.start, &b);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "DEFGH", 5) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(b.cap == 16 && b.start < b.end, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_len(&b) == 9, &b);
+
+    char dest[9] = {0};
+    T_ASSERT(io_buffer_nspit(&b, dest, 9) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "3ABCDEFGH", 9) == 0);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_shrink(&b) == IO_ERR_OK && b.cap == 16, &b);
+    io_buffer_nadvance(&b, 9);
+    T_ASSERT_FOR_BUFFER(io_buffer_shrink(&b) == IO_ERR_OK && b.cap == 4, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "0123", 4) == IO_ERR_OK, &b);
+
+    io_buffer_free(&b);
+
+    return passed;
+}
+
+bool t_buffer_case_growable_stops_at_max_capacity(void) {
+    bool passed = true;
+
+    IO_Buffer b = {0};
+    T_ASSERT(io_buffer_init_growable(&b, 4, 5) == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "0123", 4) == IO_ERR_OK, &b);
+    T_ASSERT(io_buffer_nadvance(&b, 3) == 3);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "ABC", 3) == IO_ERR_OK, &b);
+
+    // NOTE: The wrapped part ("BC") does not fit after the old end, so the
+    //       part at the end of the storage is moved instead.
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "D", 1) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(b.cap == 5 && b.end < b.start, &b);
+
+    char dest[5] = {0};
+    T_ASSERT(io_buffer_nspit(&b, dest, 5) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "3ABCD", 5) == 0);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "E", 1) == IO_ERR_OOB, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_reserve(&b, 1) == IO_ERR_OOB, &b);
+
+    io_buffer_free(&b);
+
+    IO_Buffer fixed = T_EMPTY_BUFFER(4);
+    T_ASSERT_FOR_BUFFER(io_buffer_reserve(&fixed, 4) == IO_ERR_OK, &fixed);
+    T_ASSERT_FOR_BUFFER(io_buffer_reserve(&fixed, 5) == IO_ERR_OOB, &fixed);
+    io_buffer_free(&fixed);
+
+    return passed;
+}
+
+bool t_buffer_case_pool_hands_out_aligned_blocks(void) {
+    bool passed = true;
+
+    IO_BufferPool p;
+    T_ASSERT(io_buffer_pool_init(&p, 100, 2) == IO_ERR_OK);
+    T_ASSERT(p.block_size == 128);
+
+    IO_Buffer a, b, c;
+    T_ASSERT(io_buffer_init_pooled(&a, &p) == IO_ERR_OK);
+    T_ASSERT(io_buffer_init_pooled(&b, &p) == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(a.cap == 100 && ((size_t)a.buf % IO_BUFFER_POOL_ALIGN) == 0, &a);
+    T_ASSERT_FOR_BUFFER(b.buf == a.buf + p.block_size, &b);
+    T_ASSERT(p.nfree == 0);
+
+    T_ASSERT(io_buffer_init_pooled(&c, &p) == IO_ERR_OK);
+    T_ASSERT(p.nfree == 1);
+
+    char *block = b.buf;
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "abc", 3) == IO_ERR_OK, &b);
+    T_ASSERT(io_buffer_free(&b) == IO_ERR_OK);
+    T_ASSERT(p.nfree == 2);
+    T_ASSERT(io_buffer_init_pooled(&b, &p) == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(b.buf == block && io_buffer_len(&b) == 0, &b);
+
+    io_buffer_free(&a);
+    io_buffer_free(&b);
+    io_buffer_free(&c);
+    T_ASSERT(p.nfree == 4);
+    io_buffer_pool_free(&p);
+
+    return passed;
+}
+
+bool t_buffer_case_pooled_buffer_detaches_when_empty(void) {
+    bool passed = true;
+
+    IO_BufferPool p;
+    T_ASSERT(io_buffer_pool_init(&p, 8, 4) == IO_ERR_OK);
+    IO_Buffer b;
+    T_ASSERT(io_buffer_init_pooled(&b, &p) == IO_ERR_OK);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "abc", 3) == IO_ERR_OK, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_detach(&b) == IO_ERR_OK && b.buf != NULL, &b);
+    io_buffer_nadvance(&b, 3);
+    T_ASSERT_FOR_BUFFER(io_buffer_detach(&b) == IO_ERR_OK && b.buf == NULL, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_len(&b) == 0 && b.cap == 8, &b);
+    T_ASSERT(p.nfree == 4);
+
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "xyz", 3) == IO_ERR_OK, &b);
+    T_ASSERT(b.buf != NULL && p.nfree == 3);
+    char dest[3] = {0};
+    T_ASSERT(io_buffer_nspit(&b, dest, 3) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "xyz", 3) == 0);
+
+    io_buffer_nadvance(&b, 3);
+    io_buffer_detach(&b);
+    IO_Span spans[2];
+    T_ASSERT_FOR_BUFFER(io_buffer_reserve_spans(&b, spans) == 1, &b);
+    T_ASSERT(spans[0].ptr == b.buf && spans[0].len == 8);
+
+    io_buffer_free(&b);
+    io_buffer_pool_free(&p);
+
+    return passed;
+}
+
+IO_BUFFER_STATIC(T_StaticBuffer, 8)
+
+bool t_buffer_case_static_append_and_nspit_across_wrap(void) {
+    bool passed = true;
+
+    T_StaticBuffer b;
+    T_StaticBuffer_init(&b);
+    T_ASSERT(T_StaticBuffer_append(&b, "abcdefgh", 8) == IO_ERR_OK && T_StaticBuffer_len(&b) == 8);
+    T_ASSERT(T_StaticBuffer_append(&b, "i", 1) == IO_ERR_OOB);
+    T_ASSERT(T_StaticBuffer_nadvance(&b, 6) == 6);
+
+    T_ASSERT(T_StaticBuffer_append(&b, "ijklm", 5) == IO_ERR_OK && T_StaticBuffer_len(&b) == 7);
+    T_ASSERT(T_StaticBuffer_at(&b, 0) == 'g' && T_StaticBuffer_at(&b, 6) == 'm');
+    char dest[8] = {0};
+    T_ASSERT(T_StaticBuffer_nspit(&b, dest, 8) == IO_ERR_OOB);
+    T_ASSERT(T_StaticBuffer_nspit(&b, dest, 7) == IO_ERR_OK && memcmp(dest, "ghijklm", 7) == 0);
+
+    T_ASSERT(T_StaticBuffer_nadvance(&b, 100) == 7 && T_StaticBuffer_len(&b) == 0);
+    T_ASSERT(b.head == 13 && b.tail == 13);
+
+    return passed;
+}
+
+bool t_buffer_case_static_spans(void) {
+    bool passed = true;
+
+    T_StaticBuffer b;
+    T_StaticBuffer_init(&b);
+    IO_Span spans[2] = {0};
+    T_ASSERT(T_StaticBuffer_peek_spans(&b, spans) == 0);
+
+    b.head = b.tail = 5;
+    T_ASSERT(T_StaticBuffer_reserve_spans(&b, spans) == 1);
+    T_ASSERT(spans[0].ptr == b.buf && spans[0].len == 8);
+
+    T_ASSERT(T_StaticBuffer_append(&b, "abcdef", 6) == IO_ERR_OK);
+    T_ASSERT(T_StaticBuffer_nadvance(&b, 5) == 5);
+    T_ASSERT(T_StaticBuffer_reserve_spans(&b, spans) == 2);
+    T_ASSERT(spans[0].ptr == b.buf + 6 && spans[0].len == 2);
+    T_ASSERT(spans[1].ptr == b.buf && spans[1].len == 5);
+    memcpy(spans[0].ptr, "gh", 2);
+    memcpy(spans[1].ptr, "i", 1);
+    T_ASSERT(T_StaticBuffer_commit(&b, 3) == IO_ERR_OK);
+    T_ASSERT(T_StaticBuffer_commit(&b, 5) == IO_ERR_OOB);
+
+    T_ASSERT(T_StaticBuffer_peek_spans(&b, spans) == 2);
+    T_ASSERT(spans[0].ptr == b.buf + 5 && spans[0].len == 3 && memcmp(spans[0].ptr, "fgh", 3) == 0);
+    T_ASSERT(spans[1].ptr == b.buf && spans[1].len == 1 && spans[1].ptr[0] == 'i');
+
+    return passed;
+}
+
+bool t_buffer_case_init_opts_aligns_storage(void) {
+    bool passed = true;
+
+    IO_Buffer b;
+    T_ASSERT(io_buffer_init_opts(&b, 100, &(IO_BufferOpts){0}) == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(b.flags == 0 && b.cap == 100, &b);
+    io_buffer_free(&b);
+
+    T_ASSERT(io_buffer_init_opts(&b, 100, &(IO_BufferOpts){.align = 3}) == IO_ERR_OOB);
+
+    size_t align = 1 << 16;
+    T_ASSERT(io_buffer_init_opts(&b, 100000, &(IO_BufferOpts){.align = align}) == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(b.flags == IO_BUFFER_PAGES && ((uintptr_t)b.buf % align) == 0, &b);
+    T_ASSERT_FOR_BUFFER(b.cap >= 100000 && (b.cap + 1) % align == 0, &b);
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "abc", 3) == IO_ERR_OK, &b);
+    b.start = b.end = b.buf + b.cap;
+    T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "xyz", 3) == IO_ERR_OK && io_buffer_at(&b, 2) == 'z', &b);
+    io_buffer_free(&b);
+
+    return passed;
+}
+
+bool t_buffer_case_init_opts_huge_pages_and_numa(void) {
+    bool passed = true;
+
+    IO_Buffer b;
+    T_ASSERT(io_buffer_init_opts(&b, 3 << 20, &(IO_BufferOpts){.flags = IO_BUFFER_OPT_HUGEPAGES}) == IO_ERR_OK);
+    T_ASSERT_FOR_BUFFER(((uintptr_t)b.buf % IO_HUGE_PAGE_SIZE) == 0 && b.cap + 1 == 2 * IO_HUGE_PAGE_SIZE, &b);
+    memset(b.buf, 'x', b.cap + 1);
+    io_buffer_free(&b);
+
+    // NOTE: The huge page pool is usually empty and NUMA policies may be
+    //       unavailable, so only the way those fail is checked.
+    IO_Err err = io_buffer_init_opts(&b, 100, &(IO_BufferOpts){.flags = IO_BUFFER_OPT_HUGETLB});
+    T_ASSERT(err == IO_ERR_OK || err == IO_ERR_OOM || err == IO_ERR_UNSUPPORTED);
+    if (err == IO_ERR_OK) {
+        T_ASSERT_FOR_BUFFER(b.cap + 1 == IO_HUGE_PAGE_SIZE, &b);
+        io_buffer_free(&b);
+    }
+
+    err = io_buffer_init_opts(&b, 100, &(IO_BufferOpts){.flags = IO_BUFFER_OPT_NUMA, .numa_node = 0});
+    T_ASSERT(err == IO_ERR_OK || err == IO_ERR_UNSUPPORTED);
+    if (err == IO_ERR_OK) {
+        T_ASSERT_FOR_BUFFER(io_buffer_append(&b, "abc", 3) == IO_ERR_OK, &b);
+        io_buffer_free(&b);
+    }
+    T_ASSERT(io_buffer_init_opts(&b, 100, &(IO_BufferOpts){.flags = IO_BUFFER_OPT_NUMA, .numa_node = -1}) != IO_ERR_OK);
+
+    return passed;
+}
 //////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
 
 #define T_BUFFER_CASE_MAP(XX)                                       \
@@ -405,7 +782,21 @@ bool t_buffer_case_nadvance_beyond_capacity(void) {
     XX(15, nadvance_wrap)                                           \
     XX(16, nadvance_to_0)                                           \
     XX(17, nadvance_with_empty_buffer)                              \
-    XX(18, nadvance_beyond_capacity)
+    XX(18, nadvance_beyond_capacity)                                \
+    XX(19, at_across_wrap)                                          \
+    XX(20, mirrored_append_and_nspit_across_wrap)                   \
+    XX(21, peek_spans)                                              \
+    XX(22, reserve_spans_and_commit)                                \
+    XX(23, find_across_wrap)                                        \
+    XX(24, find_any_in_long_data)                                   \
+    XX(25, growable_append_grows_and_linearizes)                    \
+    XX(26, growable_stops_at_max_capacity)                          \
+    XX(27, pool_hands_out_aligned_blocks)                           \
+    XX(28, pooled_buffer_detaches_when_empty)                       \
+    XX(29, static_append_and_nspit_across_wrap)                     \
+    XX(30, static_spans)                                            \
+    XX(31, init_opts_aligns_storage)                                \
+    XX(32, init_opts_huge_pages_and_numa)
 
 void t_buffer_run(void) {
 #define XX(num, name) do {                                              \
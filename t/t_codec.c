@@ -0,0 +1,274 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_IMPL
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_CODEC_PASSED = 0, T_CODEC_FAILED = 0;
+
+#define T_CODEC_ASSERT_FOR_READER(expr, r) do {                 \
+        bool result = T_ASSERT(expr);                           \
+        if (!result) printf("INFO: %s\n", t_reader_repr(r));    \
+    } while(0)
+
+/**
+ * Run-length codec used to test the codec stages: the stream is a sequence of
+ * (count, byte) pairs with counts from 1 to 255, terminated by a (0, 0) pair.
+ *
+ * Both sides keep whatever doesn't fit into the output (or doesn't make up a
+ * whole pair yet) in their state, as real streaming codecs do.
+ */
+typedef struct {
+    unsigned char byte, pending[2];
+    size_t run, npending;
+    bool have_count, ended;
+} T_Rle;
+
+IO_Err t_rle_encode(void *ctx, const char *in, size_t *nin, char *out, size_t *nout, int flags) {
+    T_Rle *c = ctx;
+    size_t ip = 0, op = 0;
+    IO_Err err = IO_ERR_OK;
+    for (;;) {
+        while (c->npending > 0 && op < *nout) {
+            out[op++] = c->pending[0];
+            c->pending[0] = c->pending[1];
+            c->npending--;
+        }
+        if (c->npending > 0) break;
+
+        if (ip < *nin) {
+            unsigned char byte = in[ip];
+            if (c->run > 0 && byte == c->byte && c->run < 255) {
+                c->run++;
+                ip++;
+            } else if (c->run > 0) {
+                c->pending[0] = c->run, c->pending[1] = c->byte, c->npending = 2;
+                c->run = 0;
+            } else {
+                c->byte = byte, c->run = 1;
+                ip++;
+            }
+            continue;
+        }
+
+        if (flags == 0) break;
+        if (c->run > 0) {
+            c->pending[0] = c->run, c->pending[1] = c->byte, c->npending = 2;
+            c->run = 0;
+        } else if ((flags & IO_CODEC_END) && !c->ended) {
+            c->pending[0] = c->pending[1] = 0, c->npending = 2;
+            c->ended = true;
+        } else {
+            err = IO_ERR_EOF;
+            break;
+        }
+    }
+    *nin = ip;
+    *nout = op;
+    return err;
+}
+
+IO_Err t_rle_decode(void *ctx, const char *in, size_t *nin, char *out, size_t *nout, int flags) {
+    T_Rle *c = ctx;
+    size_t ip = 0, op = 0;
+    IO_Err err = IO_ERR_OK;
+    for (;;) {
+        while (c->run > 0 && op < *nout) {
+            out[op++] = c->byte;
+            c->run--;
+        }
+        if (c->run > 0 || ip == *nin) break;
+
+        if (!c->have_count) {
+            c->pending[0] = in[ip++];
+            c->have_count = true;
+            continue;
+        }
+        c->byte = in[ip++];
+        c->have_count = false;
+        c->run = c->pending[0];
+        if (c->run == 0) {
+            err = IO_ERR_EOF;
+            break;
+        }
+    }
+    // NOTE: The input ended without the (0, 0) pair.
+    if (err == IO_ERR_OK && (flags & IO_CODEC_END) && c->run == 0 && ip == *nin) err = IO_ERR_PARTIAL;
+    *nin = ip;
+    *nout = op;
+    return err;
+}
+
+/**
+ * Encodes `n` bytes of `data` in one go into `dest` (large enough) and returns
+ * the length of the encoded stream, including its end.
+ */
+size_t t_rle_encode_all(const char *data, size_t n, char *dest, size_t cap) {
+    T_Rle c = {0};
+    size_t nin = n, nout = cap;
+    t_rle_encode(&c, data, &nin, dest, &nout, IO_CODEC_END);
+    return nout;
+}
+
+/**
+ * Fills `data` with `n` bytes made up of runs of different lengths.
+ */
+void t_runs(char *data, size_t n) {
+    size_t run = 1, i = 0;
+    for (char c = 'a'; i < n; c = (c == 'z') ? 'a' : c + 1, run = run * 7 % 600 + 1) {
+        for (size_t j = 0; j < run && i < n; j++) data[i++] = c;
+    }
+}
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_codec_case_decoder_reads_decoded_stream(void) {
+    bool passed = true;
+    static char data[4096], encoded[8192];
+    t_runs(data, sizeof(data));
+    size_t n = t_rle_encode_all(data, sizeof(data), encoded, sizeof(encoded));
+    T_ASSERT(n < sizeof(data) / 4 && encoded[n - 2] == 0 && encoded[n - 1] == 0);
+
+    // NOTE: An odd capacity makes the pairs straddle the wrap boundary.
+    IO_Reader src = T_READER_WITH_DATA(7, encoded, n);
+    T_Rle c = {0};
+    IO_Codec codec = {.step = t_rle_decode, .ctx = &c};
+    IO_Buffer b = T_EMPTY_BUFFER(512);
+    IO_Reader r;
+    IO_Decoder d;
+    T_ASSERT(io_reader_init_decoder(&r, &b, &d, &src, &codec) == IO_ERR_OK);
+
+    char peek[300] = {0};
+    T_ASSERT(io_reader_prefetch_all(&r, sizeof(peek)) == IO_ERR_OK);
+    T_ASSERT(io_reader_npeek(&r, peek, sizeof(peek)) == IO_ERR_OK);
+    T_ASSERT(memcmp(peek, data, sizeof(peek)) == 0);
+    T_CODEC_ASSERT_FOR_READER(r.pos == 0 && io_reader_buffered(&r) >= sizeof(peek), &r);
+
+    static char dest[4096];
+    T_ASSERT(io_reader_nread_full(&r, dest, sizeof(dest)) == IO_ERR_OK);
+    T_ASSERT(memcmp(dest, data, sizeof(dest)) == 0);
+    T_CODEC_ASSERT_FOR_READER(r.pos == sizeof(data) && r.nread == sizeof(data), &r);
+    T_ASSERT(io_reader_nread(&r, dest, 1) == IO_ERR_EOF);
+    T_ASSERT(d.done && d.err == IO_ERR_OK && src.pos == n);
+
+    io_buffer_free(&b);
+    T_READER_FREE(&src);
+    return passed;
+}
+
+bool t_codec_case_decoder_reports_codec_errors(void) {
+    bool passed = true;
+    char encoded[] = {3, 'x', 2, 'y', 1};
+    IO_Reader src = T_READER_WITH_DATA(8, encoded, sizeof(encoded));
+    T_Rle c = {0};
+    IO_Codec codec = {.step = t_rle_decode, .ctx = &c};
+    IO_Buffer b = T_EMPTY_BUFFER(16);
+    IO_Reader r;
+    IO_Decoder d;
+    T_ASSERT(io_reader_init_decoder(&r, &b, &d, &src, &codec) == IO_ERR_OK);
+
+    char dest[8] = {0};
+    T_ASSERT(io_reader_nread(&r, dest, 5) == IO_ERR_OK && memcmp(dest, "xxxyy", 5) == 0);
+    T_ASSERT(io_reader_nread(&r, dest, 1) == IO_ERR_FAILED_READ);
+    T_ASSERT(d.err == IO_ERR_PARTIAL && d.eof);
+    T_CODEC_ASSERT_FOR_READER(r.pos == 5, &r);
+
+    io_buffer_free(&b);
+    T_READER_FREE(&src);
+    return passed;
+}
+
+bool t_codec_case_decoder_stops_at_end_of_stream(void) {
+    bool passed = true;
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Reader src = t_new_reader(8, fds[0]);
+    T_Rle c = {0};
+    IO_Codec codec = {.step = t_rle_decode, .ctx = &c};
+    IO_Buffer b = T_EMPTY_BUFFER(16);
+    IO_Reader r;
+    IO_Decoder d;
+    T_ASSERT(io_reader_init_decoder(&r, &b, &d, &src, &codec) == IO_ERR_OK);
+
+    char dest[8] = {0};
+    T_ASSERT(io_reader_nread(&r, dest, 1) == IO_ERR_AGAIN);
+    write(fds[1], "\x04", 1);
+    T_ASSERT(io_reader_nread(&r, dest, 1) == IO_ERR_AGAIN);
+    write(fds[1], "z\x00\x00trailer", 10);
+    T_ASSERT(io_reader_nread(&r, dest, 8) == IO_ERR_PARTIAL && memcmp(dest, "zzzz", 4) == 0);
+    T_ASSERT(io_reader_nread(&r, dest, 1) == IO_ERR_EOF && d.done);
+
+    // NOTE: The data following the end of the stream is left to `src`.
+    T_ASSERT(io_reader_nread(&src, dest, 7) == IO_ERR_OK && memcmp(dest, "trailer", 7) == 0);
+
+    io_buffer_free(&b);
+    T_READER_FREE(&src);
+    close(fds[1]);
+    return passed;
+}
+
+bool t_codec_case_encoder_round_trip(void) {
+    bool passed = true;
+    static char data[4096], encoded[8192], decoded[4096], expected[8192];
+    t_runs(data, sizeof(data));
+    int fds[2];
+    IO_Writer w = t_new_writer_with_pipe(8, fds);
+    T_Rle ce = {0}, cd = {0};
+    IO_Codec codec = {.step = t_rle_encode, .ctx = &ce};
+    IO_Encoder e;
+    T_ASSERT(io_encoder_init(&e, &w, &codec) == IO_ERR_OK);
+
+    for (size_t i = 0; i < 2048; i += 100) {
+        T_ASSERT(io_encoder_write(&e, data + i, MIN(100, 2048 - i)) == IO_ERR_OK);
+    }
+    T_ASSERT(e.nwritten == 2048);
+    T_ASSERT(io_encoder_flush(&e) == IO_ERR_OK && io_writer_pending(&w) == 0);
+
+    // NOTE: Everything written so far can be decoded after a flush.
+    size_t n = t_drain(fds[0], encoded, sizeof(encoded));
+    size_t nin = n, nout = sizeof(decoded);
+    T_ASSERT(t_rle_decode(&cd, encoded, &nin, decoded, &nout, 0) == IO_ERR_OK);
+    T_ASSERT(nin == n && nout == 2048 && memcmp(decoded, data, 2048) == 0);
+
+    T_ASSERT(io_encoder_write(&e, data + 2048, 2048) == IO_ERR_OK);
+    T_ASSERT(io_encoder_finish(&e) == IO_ERR_OK && e.nwritten == sizeof(data));
+    size_t m = t_drain(fds[0], encoded + n, sizeof(encoded) - n);
+    T_ASSERT(m == t_rle_encode_all(data + 2048, 2048, expected, sizeof(expected)));
+    T_ASSERT(memcmp(encoded + n, expected, m) == 0);
+
+    nin = m, nout = sizeof(decoded) - 2048;
+    T_ASSERT(t_rle_decode(&cd, encoded + n, &nin, decoded + 2048, &nout, IO_CODEC_END) == IO_ERR_EOF);
+    T_ASSERT(nin == m && nout == 2048 && memcmp(decoded, data, sizeof(data)) == 0);
+
+    T_WRITER_FREE(&w, fds);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_CODEC_CASE_MAP(XX)                                        \
+    XX(1,  decoder_reads_decoded_stream)                            \
+    XX(2,  decoder_reports_codec_errors)                            \
+    XX(3,  decoder_stops_at_end_of_stream)                          \
+    XX(4,  encoder_round_trip)
+
+void t_codec_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_codec_case_##name();                            \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_CODEC_PASSED++; else T_CODEC_FAILED++;            \
+    } while(0);
+
+    T_CODEC_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_CODEC_PASSED, T_CODEC_PASSED + T_CODEC_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_codec_run();
+    return 0;
+}
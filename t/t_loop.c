@@ -0,0 +1,241 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#define IO_LOOP
+#define IO_IMPL
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_LOOP_PASSED = 0, T_LOOP_FAILED = 0;
+
+/**
+ * State of a test connection: what the callbacks saw and how much `on_data`
+ * should consume.
+ */
+typedef struct {
+    IO_Conn c;
+    IO_Reader r;
+    IO_Writer w;
+    IO_Buffer rb, wb;
+    int peer;
+    char data[64];
+    size_t ndata, ncalls;
+    bool consume, echo, closed;
+    IO_Err close_err;
+} T_Conn;
+
+size_t t_on_data(IO_Loop *l, IO_Conn *c, const IO_Span *spans, size_t nspans) {
+    (void)l;
+    T_Conn *t = c->ctx;
+    t->ncalls++;
+    if (!t->consume) return 0;
+
+    size_t n = 0;
+    for (size_t i = 0; i < nspans; i++) {
+        memcpy(t->data + t->ndata + n, spans[i].ptr, spans[i].len);
+        if (t->echo) io_writer_write(c->w, spans[i].ptr, spans[i].len);
+        n += spans[i].len;
+    }
+    t->ndata += n;
+    return n;
+}
+
+void t_on_close(IO_Loop *l, IO_Conn *c, IO_Err err) {
+    (void)l;
+    T_Conn *t = c->ctx;
+    t->closed = true;
+    t->close_err = err;
+}
+
+/**
+ * Sets up test connection `t` over a new non-blocking socket pair with a
+ * reader buffer of `cap` capacity and adds it to loop `l`.
+ */
+void t_new_conn(T_Conn *t, IO_Loop *l, size_t cap, bool with_writer) {
+    memset(t, 0, sizeof(*t));
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) T_FATAL("Failed to create socket pair");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    t->peer = fds[1];
+    if (io_buffer_init(&t->rb, cap) != IO_ERR_OK) T_FATAL("Failed to initialize buffer");
+    io_reader_init(&t->r, &t->rb, fds[0]);
+    t->c = (IO_Conn){.r = &t->r, .on_data = t_on_data, .on_close = t_on_close, .ctx = t};
+    if (with_writer) {
+        if (io_buffer_init(&t->wb, cap) != IO_ERR_OK) T_FATAL("Failed to initialize buffer");
+        io_writer_init(&t->w, &t->wb, fds[0]);
+        t->c.w = &t->w;
+    }
+    t->consume = true;
+    if (io_loop_add(l, &t->c) != IO_ERR_OK) T_FATAL("Failed to add connection");
+}
+
+void t_free_conn(T_Conn *t, IO_Loop *l) {
+    io_loop_remove(l, &t->c);
+    io_buffer_free(&t->rb);
+    if (t->c.w != NULL) io_buffer_free(&t->wb);
+    close(t->r.fd);
+    if (t->peer >= 0) close(t->peer);
+}
+
+/**
+ * Timer callback recording the order in which timers fire.
+ */
+static int t_fired[4], t_nfired;
+
+void t_on_timer(IO_Loop *l, IO_Timer *t) {
+    (void)l;
+    t_fired[t_nfired++] = *(int *)t->ctx;
+}
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_loop_case_delivers_data_and_closes_on_eof(void) {
+    bool passed = true;
+    IO_Loop l;
+    T_ASSERT(io_loop_init(&l) == IO_ERR_OK);
+    T_Conn t;
+    t_new_conn(&t, &l, 16, false);
+
+    write(t.peer, "hello", 5);
+    T_ASSERT(io_loop_run_once(&l, 1000) == IO_ERR_OK);
+    T_ASSERT(t.ncalls == 1 && t.ndata == 5 && strncmp(t.data, "hello", 5) == 0);
+    T_ASSERT(io_reader_buffered(&t.r) == 0 && !t.closed);
+
+    write(t.peer, " world", 6);
+    close(t.peer);
+    t.peer = -1;
+    T_ASSERT(io_loop_run_once(&l, 1000) == IO_ERR_OK);
+    T_ASSERT(t.ndata == 11 && strncmp(t.data, "hello world", 11) == 0);
+    T_ASSERT(t.closed && t.close_err == IO_ERR_EOF);
+
+    t_free_conn(&t, &l);
+    io_loop_free(&l);
+    return passed;
+}
+
+bool t_loop_case_full_buffer_pauses_reading(void) {
+    bool passed = true;
+    IO_Loop l;
+    T_ASSERT(io_loop_init(&l) == IO_ERR_OK);
+    T_Conn t;
+    t_new_conn(&t, &l, 4, false);
+    t.consume = false;
+
+    write(t.peer, "0123456789", 10);
+    T_ASSERT(io_loop_run_once(&l, 1000) == IO_ERR_OK);
+    T_ASSERT(t.ncalls == 1 && io_reader_buffered(&t.r) == 4);
+
+    write(t.peer, "AB", 2);
+    T_ASSERT(io_loop_run_once(&l, 100) == IO_ERR_OK);
+    T_ASSERT(t.ncalls == 1 && t.r.nread == 4);
+
+    t.consume = true;
+    T_ASSERT(io_loop_resume(&l, &t.c) == IO_ERR_OK);
+    T_ASSERT(t.ndata == 12 && strncmp(t.data, "0123456789AB", 12) == 0);
+    T_ASSERT(io_reader_buffered(&t.r) == 0 && !t.closed);
+
+    t_free_conn(&t, &l);
+    io_loop_free(&l);
+    return passed;
+}
+
+bool t_loop_case_full_growable_buffer_grows(void) {
+    bool passed = true;
+    IO_Loop l;
+    T_ASSERT(io_loop_init(&l) == IO_ERR_OK);
+    T_Conn t;
+    t_new_conn(&t, &l, 4, false);
+    io_buffer_free(&t.rb);
+    if (io_buffer_init_growable(&t.rb, 4, 16) != IO_ERR_OK) T_FATAL("Failed to initialize buffer");
+    t.consume = false;
+
+    write(t.peer, "0123456789", 10);
+    T_ASSERT(io_loop_run_once(&l, 1000) == IO_ERR_OK);
+    T_ASSERT(io_reader_buffered(&t.r) == 10 && t.rb.cap >= 10);
+
+    write(t.peer, "ABCDEFGHIJ", 10);
+    T_ASSERT(io_loop_run_once(&l, 1000) == IO_ERR_OK);
+    T_ASSERT(io_reader_buffered(&t.r) == 16 && t.rb.cap == 16);
+
+    t.consume = true;
+    T_ASSERT(io_loop_resume(&l, &t.c) == IO_ERR_OK);
+    T_ASSERT(t.ndata == 20 && strncmp(t.data, "0123456789ABCDEFGHIJ", 20) == 0);
+    T_ASSERT(!t.closed);
+
+    t_free_conn(&t, &l);
+    io_loop_free(&l);
+    return passed;
+}
+
+bool t_loop_case_flushes_writer(void) {
+    bool passed = true;
+    IO_Loop l;
+    T_ASSERT(io_loop_init(&l) == IO_ERR_OK);
+    T_Conn t;
+    t_new_conn(&t, &l, 16, true);
+    t.echo = true;
+
+    write(t.peer, "ping", 4);
+    T_ASSERT(io_loop_run_once(&l, 1000) == IO_ERR_OK);
+    T_ASSERT(io_writer_pending(&t.w) == 0);
+
+    char reply[8] = {0};
+    T_ASSERT(read(t.peer, reply, sizeof(reply)) == 4);
+    T_ASSERT(strncmp(reply, "ping", 4) == 0);
+
+    t_free_conn(&t, &l);
+    io_loop_free(&l);
+    return passed;
+}
+
+bool t_loop_case_timers_fire_in_order(void) {
+    bool passed = true;
+    IO_Loop l;
+    T_ASSERT(io_loop_init(&l) == IO_ERR_OK);
+
+    int ids[3] = {30, 10, 20};
+    IO_Timer timers[3] = {0};
+    t_nfired = 0;
+    for (int i = 0; i < 3; i++) {
+        timers[i] = (IO_Timer){.cb = t_on_timer, .ctx = &ids[i]};
+        T_ASSERT(io_loop_add_timer(&l, &timers[i], ids[i]) == IO_ERR_OK);
+    }
+    T_ASSERT(io_loop_cancel_timer(&l, &timers[2]) == IO_ERR_OK);
+    T_ASSERT(l.ntimers == 2 && timers[2].idx == 0);
+
+    for (int i = 0; i < 10 && t_nfired < 2; i++) T_ASSERT(io_loop_run_once(&l, -1) == IO_ERR_OK);
+    T_ASSERT(t_nfired == 2 && t_fired[0] == 10 && t_fired[1] == 30);
+    T_ASSERT(l.ntimers == 0);
+
+    io_loop_free(&l);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_LOOP_CASE_MAP(XX)                                         \
+    XX(1,  delivers_data_and_closes_on_eof)                         \
+    XX(2,  full_buffer_pauses_reading)                              \
+    XX(3,  flushes_writer)                                          \
+    XX(4,  timers_fire_in_order)                                    \
+    XX(5,  full_growable_buffer_grows)
+
+void t_loop_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_loop_case_##name();                             \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_LOOP_PASSED++; else T_LOOP_FAILED++;              \
+    } while(0);
+
+    T_LOOP_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_LOOP_PASSED, T_LOOP_PASSED + T_LOOP_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_loop_run();
+    return 0;
+}
@@ -3,10 +3,32 @@
  * TODO: Re-write tests, because right now it's just a huge slop.
  */
 
+#include <fcntl.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * Writes into `t_stuck_fd` report that nothing was written, as a sink that
+ * makes no progress would. Other writes go through.
+ */
+static int t_stuck_fd = -1;
+
+ssize_t t_write(int fd, const void *buf, size_t n) {
+    return (fd == t_stuck_fd) ? 0 : write(fd, buf, n);
+}
+
+ssize_t t_writev(int fd, const struct iovec *iov, int cnt) {
+    return (fd == t_stuck_fd) ? 0 : writev(fd, iov, cnt);
+}
+
+#define IO_WRITE t_write
+#define IO_WRITEV t_writev
 #define IO_IMPL
 #define _DEBUG
 #include "../io.h"
@@ -49,6 +71,39 @@ static long T_READER_PASSED = 0, T_READER_FAILED = 0;
 
 
 
+/**
+ * In-memory source for tests: serves `data` in chunks of at most `chunk`
+ * bytes per call and counts the calls.
+ */
+typedef struct {
+    const char *data;
+    size_t len, off, chunk, calls;
+} T_MemSource;
+
+ssize_t t_mem_source_read(void *ctx, char *buf, size_t n) {
+    T_MemSource *m = ctx;
+    m->calls++;
+    size_t to_copy = MIN(MIN(n, m->chunk), m->len - m->off);
+    memcpy(buf, m->data + m->off, to_copy);
+    m->off += to_copy;
+    return to_copy;
+}
+
+ssize_t t_mem_source_readv(void *ctx, const IO_Span *spans, int cnt) {
+    T_MemSource *m = ctx;
+    size_t total = 0, chunk = m->chunk;
+    for (int i = 0; i < cnt && total < chunk; i++) {
+        m->chunk = chunk - total;
+        size_t nread = t_mem_source_read(m, spans[i].ptr, spans[i].len);
+        m->calls--;
+        total += nread;
+        if (nread < spans[i].len) break;
+    }
+    m->chunk = chunk;
+    m->calls++;
+    return total;
+}
+
 //////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
 bool t_reader_case_init_empty(void) {
     bool passed = true;
@@ -233,6 +288,947 @@ bool t_reader_case_sequence_peek_consume_read_peek_discard(void) {
     return passed;
 }
 
+bool t_reader_case_fill_reads_into_buffer(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "ABCDEFG", 7);
+
+    T_ASSERT(io_reader_fill(&r, 5) == IO_ERR_OK);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABCDE", 5);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 5, &r);
+
+    T_ASSERT(io_reader_fill(&r, 3) == IO_ERR_PARTIAL);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABCDEFG", 7);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 7, &r);
+
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_EOF);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 7, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_fill_beyond_free_space(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(4, "ABCDEF", 6);
+
+    T_ASSERT(io_reader_fill(&r, 3) == IO_ERR_OK);
+    T_ASSERT(io_reader_fill(&r, 2) == IO_ERR_OOB);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABC", 3);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 3, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_fill_rewinds_empty_buffer(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(6, "ABCDEF", 6);
+    r.b->start = r.b->end = r.b->buf + 4;
+
+    T_ASSERT(io_reader_fill(&r, 6) == IO_ERR_OK);
+    T_ASSERT(r.b->start == r.b->buf);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABCDEF", 6);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 6, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_prefetch_into_empty_buffer(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "ABCDEFGH", 8);
+
+    T_ASSERT(io_reader_prefetch(&r, 4) == IO_ERR_OK);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABCD", 4);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 4, &r);
+
+    T_ASSERT(io_reader_prefetch(&r, 2) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 4, &r);
+
+    T_ASSERT(io_reader_prefetch(&r, 9) == IO_ERR_OOB);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_fill_across_wrap(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(6, "ABCDEFGH", 8);
+    r.b->buf[4] = 'X';
+    r.b->start = r.b->buf + 4;
+    r.b->end = r.b->buf + 5;
+    r.nread = 1;
+
+    T_ASSERT(io_reader_fill(&r, 5) == IO_ERR_OK);
+    T_ASSERT(r.b->start == r.b->buf + 4);
+    T_ASSERT(r.b->end == r.b->buf + 3);
+    T_READER_ASSERT_BUFFER_EQ(&r, "XABCDE", 6);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 6, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_prefetch_tops_up_partially_buffered(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "ABCDEFGH", 8);
+
+    T_ASSERT(io_reader_prefetch(&r, 3) == IO_ERR_OK);
+    T_ASSERT(io_reader_prefetch(&r, 6) == IO_ERR_OK);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABCDEF", 6);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 6, &r);
+
+    T_ASSERT(io_reader_prefetch(&r, 8) == IO_ERR_OK);
+    T_ASSERT(io_reader_prefetch(&r, 8) == IO_ERR_OK);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABCDEFGH", 8);
+
+    T_ASSERT(io_reader_nconsume(&r, NULL, 7) == IO_ERR_OK);
+    T_ASSERT(io_reader_prefetch(&r, 2) == IO_ERR_PARTIAL);
+    T_READER_ASSERT_BUFFER_EQ(&r, "H", 1);
+
+    T_ASSERT(io_reader_nconsume(&r, NULL, 1) == IO_ERR_OK);
+    T_ASSERT(io_reader_prefetch(&r, 2) == IO_ERR_EOF);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_prefetch_all_stops_at_EOF(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "ABC", 3);
+
+    T_ASSERT(io_reader_prefetch_all(&r, 6) == IO_ERR_PARTIAL);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABC", 3);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 3, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_prefetch_all_stops_when_would_block(void) {
+    bool passed = true;
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Reader r = t_new_reader(8, fds[0]);
+
+    T_ASSERT(io_reader_prefetch_all(&r, 4) == IO_ERR_AGAIN);
+
+    write(fds[1], "AB", 2);
+    T_ASSERT(io_reader_prefetch_all(&r, 4) == IO_ERR_AGAIN);
+    T_READER_ASSERT_BUFFER_EQ(&r, "AB", 2);
+
+    write(fds[1], "CDE", 3);
+    T_ASSERT(io_reader_prefetch_all(&r, 4) == IO_ERR_OK);
+    T_READER_ASSERT_BUFFER_EQ(&r, "ABCD", 4);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 4, &r);
+
+    close(fds[1]);
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_commit_and_consume_spans(void) {
+    bool passed = true;
+    IO_Buffer b = T_EMPTY_BUFFER(8);
+    IO_Reader r = {0};
+    io_reader_init(&r, &b, 0);
+
+    IO_Span spans[2];
+    T_ASSERT(io_buffer_reserve_spans(r.b, spans) == 1);
+    memcpy(spans[0].ptr, "HELLO", 5);
+    T_ASSERT(io_reader_commit(&r, 5) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 5, &r);
+    T_ASSERT(io_reader_commit(&r, 4) == IO_ERR_OOB);
+
+    T_ASSERT(io_buffer_peek_spans(r.b, spans) == 1);
+    T_ASSERT(spans[0].len == 5 && strncmp(spans[0].ptr, "HELLO", 5) == 0);
+    T_ASSERT(io_reader_nconsume(&r, NULL, spans[0].len) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == 5 && r.nread == 5, &r);
+    T_READER_ASSERT_BUFFER_EQ(&r, "", 0);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_reader_case_readline_lf_and_crlf(void) {
+    bool passed = true;
+    const char *data = "first\nsecond\r\n\nlast";
+    IO_Reader r = T_READER_WITH_DATA(16, data, strlen(data));
+
+    IO_Span line;
+    char scratch[16];
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(line.len == 5 && strncmp(line.ptr, "first", 5) == 0);
+    T_ASSERT(line.ptr == r.b->buf);
+    T_READER_ASSERT_FOR_READER(r.pos == 6, &r);
+
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(line.len == 6 && strncmp(line.ptr, "second", 6) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 14, &r);
+
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(line.len == 0);
+
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_PARTIAL);
+    T_ASSERT(line.len == 4 && strncmp(line.ptr, "last", 4) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == r.nread && r.pos == strlen(data), &r);
+
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_EOF);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_until_copies_wrapped_record(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "abc;defghij;", 12);
+
+    IO_Span rec;
+    char scratch[8] = {0};
+    T_ASSERT(io_reader_read_until(&r, ";", 1, &rec, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(rec.len == 3 && strncmp(rec.ptr, "abc", 3) == 0);
+    T_ASSERT(rec.ptr != scratch);
+
+    T_ASSERT(io_reader_read_until(&r, ";", 1, &rec, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(rec.len == 7 && strncmp(rec.ptr, "defghij", 7) == 0);
+    T_ASSERT(rec.ptr == scratch);
+    T_READER_ASSERT_FOR_READER(r.pos == 12 && r.nread == 12, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_until_multibyte_delimiter(void) {
+    bool passed = true;
+    const char *data = "Host: x\r\n\r\nbody";
+    IO_Reader r = T_READER_WITH_DATA(32, data, strlen(data));
+
+    IO_Span rec;
+    T_ASSERT(io_reader_read_until(&r, "\r\n\r\n", 4, &rec, NULL, 32) == IO_ERR_OK);
+    T_ASSERT(rec.len == 7 && strncmp(rec.ptr, "Host: x", 7) == 0);
+    T_READER_ASSERT_BUFFER_EQ(&r, "body", 4);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_readline_longer_than_maxlen(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(16, "0123456789\nab\n", 14);
+
+    IO_Span line;
+    char scratch[4];
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OOB);
+    T_READER_ASSERT_FOR_READER(r.pos == 0, &r);
+
+    T_ASSERT(io_reader_nconsume(&r, NULL, 11) == IO_ERR_OK);
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(line.len == 2 && strncmp(line.ptr, "ab", 2) == 0);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_nonblocking_peek_and_read(void) {
+    bool passed = true;
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Reader r = t_new_reader(8, fds[0]);
+
+    char dest[8] = {0};
+    T_ASSERT(io_reader_npeek(&r, dest, 4) == IO_ERR_AGAIN);
+    T_ASSERT(io_reader_nread(&r, dest, 4) == IO_ERR_AGAIN);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 0, &r);
+
+    write(fds[1], "ABC", 3);
+    T_ASSERT(io_reader_npeek(&r, dest, 2) == IO_ERR_OK);
+    T_ASSERT(io_reader_nread(&r, dest, 4) == IO_ERR_PARTIAL);
+    T_ASSERT(strncmp(dest, "ABC", 3) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 3 && r.nread == 3, &r);
+    T_READER_ASSERT_BUFFER_EQ(&r, "", 0);
+
+    close(fds[1]);
+    T_ASSERT(io_reader_nread(&r, dest, 4) == IO_ERR_EOF);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_nonblocking_readline_resumes(void) {
+    bool passed = true;
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Reader r = t_new_reader(16, fds[0]);
+
+    IO_Span line;
+    char scratch[16];
+    write(fds[1], "hel", 3);
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_AGAIN);
+    T_READER_ASSERT_BUFFER_EQ(&r, "hel", 3);
+
+    write(fds[1], "lo\nwo", 5);
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(line.len == 5 && strncmp(line.ptr, "hello", 5) == 0);
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_AGAIN);
+    T_READER_ASSERT_BUFFER_EQ(&r, "wo", 2);
+
+    close(fds[1]);
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_custom_source(void) {
+    bool passed = true;
+    IO_Buffer b = T_EMPTY_BUFFER(16);
+    T_MemSource m = {.data = "line one\nline two\n", .len = 18, .chunk = 5};
+    IO_Source src = {.read = t_mem_source_read, .ctx = &m};
+    IO_Reader r = {0};
+    T_ASSERT(io_reader_init_source(&r, &b, &src) == IO_ERR_OK);
+
+    char dest[8] = {0};
+    T_ASSERT(io_reader_npeek(&r, dest, 3) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "lin", 3) == 0);
+    T_ASSERT(io_reader_prefetch_all(&r, 8) == IO_ERR_OK);
+    T_READER_ASSERT_BUFFER_EQ(&r, "line one", 8);
+    T_ASSERT(io_reader_nread(&r, dest, 8) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == 8 && r.nread == 8, &r);
+
+    IO_Span line;
+    char scratch[8];
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(line.len == 0);
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_OK);
+    T_ASSERT(line.len == 8 && strncmp(line.ptr, "line two", 8) == 0);
+    T_ASSERT(io_reader_readline(&r, &line, scratch, sizeof(scratch)) == IO_ERR_EOF);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_reader_case_custom_source_readv_fills_wrapped_buffer(void) {
+    bool passed = true;
+    IO_Buffer b = T_EMPTY_BUFFER(6);
+    T_MemSource m = {.data = "ABCDEF", .len = 6, .chunk = 6};
+    IO_Source src = {.read = t_mem_source_read, .readv = t_mem_source_readv, .ctx = &m};
+    IO_Reader r = {0};
+    T_ASSERT(io_reader_init_source(&r, &b, &src) == IO_ERR_OK);
+    b.start = b.end = b.buf + 4;
+    b.buf[4] = 'X';
+    b.end++;
+    r.nread = 1;
+
+    T_ASSERT(io_reader_fill(&r, 5) == IO_ERR_OK);
+    T_ASSERT(m.calls == 1);
+    T_READER_ASSERT_BUFFER_EQ(&r, "XABCDE", 6);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_reader_case_mmap_serves_file_from_mapping(void) {
+    bool passed = true;
+    const char *data = "header\nsome payload that is larger than usual\n";
+    int fd = t_new_file_with_data(data, strlen(data));
+    IO_Buffer b;
+    IO_Reader r;
+    T_ASSERT(io_reader_init_mmap(&r, &b, fd) == IO_ERR_OK);
+    T_ASSERT(b.cap == strlen(data));
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == strlen(data), &r);
+
+    char dest[64] = {0};
+    T_ASSERT(io_reader_npeek(&r, dest, strlen(data)) == IO_ERR_OK);
+    T_ASSERT(strcmp(dest, data) == 0);
+    T_ASSERT(io_reader_npeek(&r, dest, strlen(data) + 1) == IO_ERR_OOB);
+
+    IO_Span line;
+    T_ASSERT(io_reader_readline(&r, &line, NULL, 64) == IO_ERR_OK);
+    T_ASSERT(line.ptr == b.buf && line.len == 6);
+
+    IO_Span spans[2];
+    T_ASSERT(io_buffer_peek_spans(r.b, spans) == 1);
+    T_ASSERT(spans[0].ptr == b.buf + 7 && spans[0].len == strlen(data) - 7);
+    T_ASSERT(io_buffer_reserve_spans(r.b, spans) == 0);
+
+    T_ASSERT(io_reader_nread(&r, dest, 64) == IO_ERR_PARTIAL);
+    T_READER_ASSERT_FOR_READER(r.pos == strlen(data) && r.nread == strlen(data), &r);
+    T_ASSERT(io_reader_nread(&r, dest, 1) == IO_ERR_EOF);
+    T_ASSERT(io_reader_prefetch(&r, 1) == IO_ERR_EOF);
+
+    io_buffer_free(&b);
+    close(fd);
+    return passed;
+}
+
+bool t_reader_case_mmap_starts_at_current_offset(void) {
+    bool passed = true;
+    int fd = t_new_file_with_data("0123456789", 10);
+    lseek(fd, 4, SEEK_SET);
+    IO_Buffer b;
+    IO_Reader r;
+    T_ASSERT(io_reader_init_mmap(&r, &b, fd) == IO_ERR_OK);
+    T_READER_ASSERT_BUFFER_EQ(&r, "456789", 6);
+
+    io_buffer_free(&b);
+    close(fd);
+    return passed;
+}
+
+bool t_reader_case_mmap_rejects_pipe(void) {
+    bool passed = true;
+    int fd = t_new_pipe_with_data("ABC", 3);
+    IO_Buffer b;
+    IO_Reader r;
+    T_ASSERT(io_reader_init_mmap(&r, &b, fd) == IO_ERR_UNSUPPORTED);
+
+    close(fd);
+    return passed;
+}
+
+bool t_reader_case_mmap_readline_without_trailing_newline(void) {
+    bool passed = true;
+    const char *files[] = {"abc", "x\nabc"};
+    for (size_t i = 0; i < 2; i++) {
+        int fd = t_new_file_with_data(files[i], strlen(files[i]));
+        IO_Buffer b;
+        IO_Reader r;
+        T_ASSERT(io_reader_init_mmap(&r, &b, fd) == IO_ERR_OK);
+
+        IO_Span line;
+        if (i == 1) T_ASSERT(io_reader_readline(&r, &line, NULL, 64) == IO_ERR_OK && line.len == 1);
+        T_ASSERT(io_reader_readline(&r, &line, NULL, 2) == IO_ERR_OOB);
+        T_ASSERT(io_reader_readline(&r, &line, NULL, 64) == IO_ERR_PARTIAL);
+        T_ASSERT(line.len == 3 && memcmp(line.ptr, "abc", 3) == 0);
+        T_ASSERT(io_reader_readline(&r, &line, NULL, 64) == IO_ERR_EOF);
+
+        io_buffer_free(&b);
+        close(fd);
+    }
+    return passed;
+}
+
+bool t_reader_case_nread_full_reads_past_capacity(void) {
+    bool passed = true;
+    char data[64];
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = 'A' + i % 26;
+    IO_Buffer b = T_EMPTY_BUFFER(8);
+    T_MemSource m = {.data = data, .len = sizeof(data), .chunk = 16};
+    IO_Source src = {.read = t_mem_source_read, .readv = t_mem_source_readv, .ctx = &m};
+    IO_Reader r = {0};
+    T_ASSERT(io_reader_init_source(&r, &b, &src) == IO_ERR_OK);
+    T_ASSERT(io_reader_prefetch(&r, 4) == IO_ERR_OK);
+
+    char dest[64] = {0};
+    m.calls = 0;
+    T_ASSERT(io_reader_nread_full(&r, dest, 40) == IO_ERR_OK);
+    T_ASSERT(memcmp(dest, data, 40) == 0);
+    T_ASSERT(m.calls == 3);
+    T_READER_ASSERT_FOR_READER(r.pos == 40 && r.nread == 48, &r);
+    T_READER_ASSERT_BUFFER_EQ(&r, data + 40, 8);
+
+    T_ASSERT(io_reader_nread_full(&r, dest, 64) == IO_ERR_PARTIAL);
+    T_ASSERT(memcmp(dest, data + 40, 24) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 64 && r.nread == 64, &r);
+    T_ASSERT(io_reader_nread_full(&r, dest, 1) == IO_ERR_EOF);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_reader_case_nread_full_reads_ahead_into_buffer(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "0123456789ABCDEFGHIJ", 20);
+
+    char dest[12] = {0};
+    T_ASSERT(io_reader_nread_full(&r, dest, 12) == IO_ERR_OK);
+    T_ASSERT(memcmp(dest, "0123456789AB", 12) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 12 && r.nread == 20, &r);
+    T_READER_ASSERT_BUFFER_EQ(&r, "CDEFGHIJ", 8);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_nread_full_resumes_when_would_block(void) {
+    bool passed = true;
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Reader r = t_new_reader(8, fds[0]);
+
+    char dest[16] = {0};
+    write(fds[1], "0123456789", 10);
+    T_ASSERT(io_reader_nread_full(&r, dest, 16) == IO_ERR_AGAIN);
+    T_READER_ASSERT_FOR_READER(r.pos == 10 && r.nread == 10, &r);
+
+    write(fds[1], "ABCDEF", 6);
+    T_ASSERT(io_reader_nread_full(&r, dest + r.pos, 16 - r.pos) == IO_ERR_OK);
+    T_ASSERT(memcmp(dest, "0123456789ABCDEF", 16) == 0);
+
+    T_READER_FREE(&r);
+    close(fds[1]);
+    return passed;
+}
+
+bool t_reader_case_readahead_batches_small_reads(void) {
+    bool passed = true;
+    const char *data = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+    IO_Buffer b = T_EMPTY_BUFFER(32);
+    T_MemSource m = {.data = data, .len = 32, .chunk = 32};
+    IO_Source src = {.read = t_mem_source_read, .readv = t_mem_source_readv, .ctx = &m};
+    IO_Reader r = {0};
+    T_ASSERT(io_reader_init_source(&r, &b, &src) == IO_ERR_OK);
+    T_ASSERT(io_reader_set_readahead(&r, 16, 8) == IO_ERR_OOB);
+    T_ASSERT(io_reader_set_readahead(&r, 8, 32) == IO_ERR_OK);
+
+    char dest[4] = {0};
+    T_ASSERT(io_reader_npeek(&r, dest, 4) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "0123", 4) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && r.nread == 8 && r.ra_cur == 16, &r);
+    T_ASSERT(io_reader_nread(&r, dest, 4) == IO_ERR_OK);
+    T_ASSERT(io_reader_nread(&r, dest, 4) == IO_ERR_OK);
+    T_ASSERT(m.calls == 1);
+
+    T_ASSERT(io_reader_nread(&r, dest, 4) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "89AB", 4) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 12 && r.nread == 24 && r.ra_cur == 32, &r);
+    for (int i = 0; i < 5; i++) T_ASSERT(io_reader_nread(&r, dest, 4) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "STUV", 4) == 0);
+    T_ASSERT(m.calls == 3);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_reader_case_readahead_shrinks_on_short_reads(void) {
+    bool passed = true;
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Reader r = t_new_reader(64, fds[0]);
+    T_ASSERT(io_reader_set_readahead(&r, 4, 64) == IO_ERR_OK);
+
+    write(fds[1], "0123456789ABCDE", 15);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_OK);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.nread == 12 && r.ra_cur == 16, &r);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.nread == 15 && r.ra_cur == 8, &r);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_AGAIN);
+    T_READER_ASSERT_FOR_READER(r.nread == 15 && r.ra_cur == 4, &r);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_AGAIN);
+    T_READER_ASSERT_FOR_READER(r.ra_cur == 4, &r);
+
+    T_READER_FREE(&r);
+    close(fds[1]);
+    return passed;
+}
+
+bool t_reader_case_growable_buffer_fits_long_line(void) {
+    bool passed = true;
+    IO_Buffer b = {0};
+    T_ASSERT(io_buffer_init_growable(&b, 4, 32) == IO_ERR_OK);
+    IO_Reader r = {0};
+    io_reader_init(&r, &b, t_new_pipe_with_data("a fairly long line\nok\n", 22));
+
+    char dest[8] = {0};
+    T_ASSERT(io_reader_npeek(&r, dest, 6) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "a fair", 6) == 0);
+    T_READER_ASSERT_FOR_READER(b.cap == 8, &r);
+
+    IO_Span line;
+    T_ASSERT(io_reader_readline(&r, &line, NULL, 64) == IO_ERR_OK);
+    T_ASSERT(line.len == 18 && strncmp(line.ptr, "a fairly long line", 18) == 0);
+    T_READER_ASSERT_FOR_READER(b.cap == 32, &r);
+    T_ASSERT(io_reader_readline(&r, &line, NULL, 64) == IO_ERR_OK);
+    T_ASSERT(line.len == 2 && strncmp(line.ptr, "ok", 2) == 0);
+
+    T_ASSERT(io_buffer_shrink(&b) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(b.cap == 4 && io_reader_buffered(&r) == 0, &r);
+    T_ASSERT(io_reader_prefetch(&r, 33) == IO_ERR_OOB);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_pooled_buffer_reattaches_on_read(void) {
+    bool passed = true;
+    IO_BufferPool p;
+    T_ASSERT(io_buffer_pool_init(&p, 16, 1) == IO_ERR_OK);
+    IO_Buffer b;
+    T_ASSERT(io_buffer_init_pooled(&b, &p) == IO_ERR_OK);
+    IO_Reader r = {0};
+    io_reader_init(&r, &b, t_new_pipe_with_data("one\ntwo\n", 8));
+
+    IO_Span line;
+    T_ASSERT(io_reader_readline(&r, &line, NULL, 16) == IO_ERR_OK);
+    T_ASSERT(line.len == 3 && strncmp(line.ptr, "one", 3) == 0);
+    T_ASSERT(io_buffer_detach(&b) == IO_ERR_OK && b.buf != NULL);
+    T_ASSERT(io_reader_nconsume(&r, NULL, 4) == IO_ERR_OK);
+    T_ASSERT(io_buffer_detach(&b) == IO_ERR_OK && b.buf == NULL && p.nfree == 1);
+
+    T_ASSERT(io_reader_readline(&r, &line, NULL, 16) == IO_ERR_EOF);
+    T_READER_ASSERT_FOR_READER(b.buf != NULL && p.nfree == 0 && r.pos == 8, &r);
+
+    T_READER_FREE(&r);
+    io_buffer_pool_free(&p);
+    return passed;
+}
+
+bool t_reader_case_read_frame_views_payload_in_buffer(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(16, "\0\0\0\5hello\0\0\0\0", 13);
+
+    IO_Frame f = {0};
+    T_ASSERT(io_reader_read_frame_u32be(&r, &f, NULL, 16) == IO_ERR_OK);
+    T_ASSERT(f.len == 5 && f.nspans == 1 && strncmp(f.spans[0].ptr, "hello", 5) == 0);
+    T_ASSERT(f.spans[0].ptr == r.b->buf + 4);
+
+    T_ASSERT(io_reader_read_frame_u32be(&r, &f, NULL, 16) == IO_ERR_OK);
+    T_ASSERT(f.len == 0 && f.nspans == 0);
+    T_ASSERT(io_reader_read_frame_u32be(&r, &f, NULL, 16) == IO_ERR_EOF);
+    T_READER_ASSERT_FOR_READER(r.pos == 13 && r.nread == 13, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_frame_wrapped_payload_in_two_spans(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "\3abc\5defgh", 10);
+
+    IO_Frame f = {0};
+    T_ASSERT(io_reader_prefetch(&r, 8) == IO_ERR_OK);
+    T_ASSERT(io_reader_read_frame_u8(&r, &f, NULL, 8) == IO_ERR_OK);
+    T_ASSERT(f.len == 3 && strncmp(f.spans[0].ptr, "abc", 3) == 0);
+
+    T_ASSERT(io_reader_read_frame_u8(&r, &f, NULL, 8) == IO_ERR_OK);
+    T_ASSERT(f.len == 5 && f.nspans == 2);
+    T_ASSERT(f.spans[0].len == 4 && strncmp(f.spans[0].ptr, "defg", 4) == 0);
+    T_ASSERT(f.spans[1].len == 1 && f.spans[1].ptr[0] == 'h');
+    T_READER_ASSERT_FOR_READER(r.pos == 10 && io_reader_buffered(&r) == 0, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_frame_larger_than_buffer_reads_into_dest(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "\x14\0ABCDEFGHIJKLMNOPQRST\2\0UV", 26);
+
+    IO_Frame f = {0};
+    T_ASSERT(io_reader_read_frame_u16le(&r, &f, NULL, 32) == IO_ERR_OOB);
+    T_ASSERT(io_reader_read_frame_u16le(&r, &f, NULL, 16) == IO_ERR_OOB);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && io_reader_buffered(&r) == 2, &r);
+
+    char dest[32] = {0};
+    T_ASSERT(io_reader_read_frame_u16le(&r, &f, dest, 32) == IO_ERR_OK);
+    T_ASSERT(f.len == 20 && f.nspans == 1 && f.spans[0].ptr == dest);
+    T_ASSERT(strncmp(dest, "ABCDEFGHIJKLMNOPQRST", 20) == 0);
+
+    T_ASSERT(io_reader_read_frame_u16le(&r, &f, dest, 32) == IO_ERR_OK);
+    T_ASSERT(f.len == 2 && f.spans[0].ptr != dest && strncmp(f.spans[0].ptr, "UV", 2) == 0);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_frame_varint(void) {
+    bool passed = true;
+    char data[] = "\x05hello\x82\x01";
+    IO_Reader r = T_READER_WITH_DATA(16, data, 8);
+
+    IO_Frame f = {0};
+    T_ASSERT(io_reader_read_frame_varint(&r, &f, NULL, 1024) == IO_ERR_OK);
+    T_ASSERT(f.len == 5 && strncmp(f.spans[0].ptr, "hello", 5) == 0);
+
+    // NOTE: 130 byte frame is announced, but the stream ends right after
+    //       its header.
+    char dest[256];
+    T_ASSERT(io_reader_read_frame_varint(&r, &f, dest, 64) == IO_ERR_OOB);
+    T_ASSERT(io_reader_read_frame_varint(&r, &f, dest, sizeof(dest)) == IO_ERR_PARTIAL);
+    T_READER_FREE(&r);
+
+    r = T_READER_WITH_DATA(16, "\xff\xff\xff\xff\xff\xff\xff\xff\xff\x7f", 10);
+    T_ASSERT(io_reader_read_frame_varint(&r, &f, dest, sizeof(dest)) == IO_ERR_OOB);
+    T_READER_ASSERT_FOR_READER(r.pos == 0, &r);
+    T_READER_FREE(&r);
+
+    r = T_READER_WITH_DATA(16, "\0\0\0\x09shor", 8);
+    T_ASSERT(io_reader_read_frame_u32be(&r, &f, NULL, 16) == IO_ERR_PARTIAL);
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && io_reader_buffered(&r) == 8, &r);
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_records_takes_all_buffered_records(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(16, "a\nbb\nccc\ndd\nee", 14);
+
+    IO_Span recs[8];
+    size_t n = 2;
+    T_ASSERT(io_reader_read_records(&r, "\n", 1, recs, &n, NULL, 16) == IO_ERR_OK);
+    T_ASSERT(n == 2 && recs[0].len == 1 && recs[1].len == 2);
+    T_READER_ASSERT_FOR_READER(r.pos == 5 && r.nread == 14, &r);
+
+    n = 8;
+    T_ASSERT(io_reader_read_records(&r, "\n", 1, recs, &n, NULL, 16) == IO_ERR_OK);
+    T_ASSERT(n == 2);
+    T_ASSERT(recs[0].len == 3 && strncmp(recs[0].ptr, "ccc", 3) == 0);
+    T_ASSERT(recs[1].len == 2 && strncmp(recs[1].ptr, "dd", 2) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 12 && r.nread == 14, &r);
+
+    n = 8;
+    T_ASSERT(io_reader_read_records(&r, "\n", 1, recs, &n, NULL, 16) == IO_ERR_PARTIAL);
+    T_ASSERT(n == 1 && recs[0].len == 2 && strncmp(recs[0].ptr, "ee", 2) == 0);
+    n = 8;
+    T_ASSERT(io_reader_read_records(&r, "\n", 1, recs, &n, NULL, 16) == IO_ERR_EOF);
+    T_ASSERT(n == 0);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_records_copies_wrapped_record(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(8, "ab;cd;efgh;i;j", 14);
+
+    T_ASSERT(io_reader_prefetch(&r, 7) == IO_ERR_OK);
+    T_ASSERT(io_reader_nconsume(&r, NULL, 6) == IO_ERR_OK);
+    T_ASSERT(io_reader_prefetch(&r, 8) == IO_ERR_OK);
+
+    IO_Span recs[8];
+    size_t n = 8;
+    T_ASSERT(io_reader_read_records(&r, ";", 1, recs, &n, NULL, 8) == IO_ERR_OOB);
+    T_READER_ASSERT_FOR_READER(n == 0 && r.pos == 6, &r);
+
+    char scratch[8];
+    n = 8;
+    T_ASSERT(io_reader_read_records(&r, ";", 1, recs, &n, scratch, 8) == IO_ERR_OK);
+    T_ASSERT(n == 2);
+    T_ASSERT(recs[0].ptr == scratch && recs[0].len == 4 && strncmp(scratch, "efgh", 4) == 0);
+    T_ASSERT(recs[1].ptr != scratch && recs[1].len == 1 && recs[1].ptr[0] == 'i');
+    T_READER_ASSERT_FOR_READER(r.pos == 13 && io_reader_buffered(&r) == 1, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_read_frames_takes_all_buffered_frames(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(32, "\0\2ab\0\3cde\0\1f\0\5gh", 16);
+
+    IO_Frame frames[8];
+    size_t n = 8;
+    T_ASSERT(io_reader_read_frames_u16be(&r, frames, &n, 16) == IO_ERR_OK);
+    T_ASSERT(n == 3);
+    T_ASSERT(frames[0].len == 2 && strncmp(frames[0].spans[0].ptr, "ab", 2) == 0);
+    T_ASSERT(frames[1].len == 3 && strncmp(frames[1].spans[0].ptr, "cde", 3) == 0);
+    T_ASSERT(frames[2].len == 1 && frames[2].spans[0].ptr[0] == 'f');
+    T_READER_ASSERT_FOR_READER(r.pos == 12 && io_reader_buffered(&r) == 4, &r);
+
+    n = 8;
+    T_ASSERT(io_reader_read_frames_u16be(&r, frames, &n, 16) == IO_ERR_PARTIAL);
+    T_READER_ASSERT_FOR_READER(n == 0 && r.pos == 12, &r);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_reader_case_forward_buffered_then_pipe(void) {
+    bool passed = true;
+    const char *data = "header|payload that is forwarded without copies";
+    IO_Reader r = T_READER_WITH_DATA(8, data, strlen(data));
+    int out[2];
+    if (pipe(out) == -1) T_FATAL("Failed to create pipe");
+    fcntl(out[0], F_SETFL, O_NONBLOCK);
+
+    char head[7] = {0};
+    T_ASSERT(io_reader_nread(&r, head, 6) == IO_ERR_OK && memcmp(head, "header", 6) == 0);
+    T_ASSERT(io_reader_fill(&r, 4) == IO_ERR_OK && io_reader_buffered(&r) > 0);
+
+    size_t rest = strlen(data) - 6;
+    T_ASSERT(io_reader_forward(&r, out[1], rest, NULL) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == strlen(data) && r.nread == r.pos, &r);
+    T_READER_ASSERT_FOR_READER(io_reader_buffered(&r) == 0, &r);
+
+    char got[64] = {0};
+    T_ASSERT(t_drain(out[0], got, sizeof(got)) == rest && memcmp(got, data + 6, rest) == 0);
+    T_ASSERT(io_reader_forward(&r, out[1], 1, NULL) == IO_ERR_EOF);
+
+    T_READER_FREE(&r);
+    close(out[0]); close(out[1]);
+    return passed;
+}
+
+bool t_reader_case_forward_file_to_file(void) {
+    bool passed = true;
+    const char *data = "0123456789abcdefghijklmnopqrstuvwxyz";
+    IO_Reader r = t_new_reader(4, t_new_file_with_data(data, strlen(data)));
+    int out = t_new_file_with_data("", 0);
+
+    char head[10];
+    T_ASSERT(io_reader_nread(&r, head, sizeof(head)) == IO_ERR_OK);
+    T_ASSERT(io_reader_forward(&r, out, 20, NULL) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == 30 && r.nread == 30, &r);
+    T_ASSERT(io_reader_forward(&r, out, 20, NULL) == IO_ERR_PARTIAL);
+    T_READER_ASSERT_FOR_READER(r.pos == strlen(data), &r);
+
+    char got[64] = {0};
+    T_ASSERT(pread(out, got, sizeof(got), 0) == 26 && memcmp(got, data + 10, 26) == 0);
+
+    T_READER_FREE(&r);
+    close(out);
+    return passed;
+}
+
+bool t_reader_case_forward_socket_through_pipe(void) {
+    bool passed = true;
+    const char *data = "socket to socket through a kernel pipe";
+    size_t n = strlen(data);
+    int in[2], out[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, in) == -1 || socketpair(AF_UNIX, SOCK_STREAM, 0, out) == -1)
+        T_FATAL("Failed to create socketpair");
+    write(in[1], data, n);
+    close(in[1]);
+    fcntl(out[1], F_SETFL, O_NONBLOCK);
+
+    IO_Reader r = t_new_reader(16, in[0]);
+    IO_Pipe p;
+    T_ASSERT(io_pipe_init(&p) == IO_ERR_OK);
+    T_ASSERT(io_reader_forward(&r, out[0], n, &p) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == n && r.nread == n && p.pending == 0, &r);
+
+    char got[64] = {0};
+    T_ASSERT(read(out[1], got, sizeof(got)) == (ssize_t)n && memcmp(got, data, n) == 0);
+    T_ASSERT(io_reader_forward(&r, out[0], 1, &p) == IO_ERR_EOF);
+
+    io_pipe_free(&p);
+    T_READER_FREE(&r);
+    close(out[0]); close(out[1]);
+    return passed;
+}
+
+bool t_reader_case_forward_writes_pending_before_buffered(void) {
+    bool passed = true;
+    int in[2], out[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, in) == -1 || socketpair(AF_UNIX, SOCK_STREAM, 0, out) == -1)
+        T_FATAL("Failed to create socketpair");
+    fcntl(out[1], F_SETFL, O_NONBLOCK);
+
+    IO_Reader r = t_new_reader(16, in[0]);
+    IO_Pipe p;
+    T_ASSERT(io_pipe_init(&p) == IO_ERR_OK);
+    // NOTE: Simulates a previous call that took "FIRST" from the stream but
+    //       could not write it yet, after which "LATER" got buffered.
+    write(p.fds[1], "FIRST", 5);
+    p.pending = 5;
+    write(in[1], "LATER", 5);
+    close(in[1]);
+    T_ASSERT(io_reader_fill(&r, 5) == IO_ERR_OK && io_reader_buffered(&r) == 5);
+
+    T_ASSERT(io_reader_forward(&r, out[0], 10, &p) == IO_ERR_OK);
+    T_READER_ASSERT_FOR_READER(r.pos == 10 && r.nread == 10 && p.pending == 0, &r);
+    char got[16] = {0};
+    T_ASSERT(t_drain(out[1], got, sizeof(got)) == 10 && memcmp(got, "FIRSTLATER", 10) == 0);
+
+    io_pipe_free(&p);
+    T_READER_FREE(&r);
+    close(out[0]); close(out[1]);
+    return passed;
+}
+
+bool t_reader_case_forward_reports_destination_errors(void) {
+    bool passed = true;
+    const char *data = "0123456789abcdefghijklmnopqrstuvwxyz";
+    IO_Reader r = t_new_reader(4, t_new_file_with_data(data, strlen(data)));
+    int out[2];
+    if (pipe(out) == -1) T_FATAL("Failed to create pipe");
+    close(out[0]);
+
+    void (*prev)(int) = signal(SIGPIPE, SIG_IGN);
+    T_ASSERT(io_reader_forward(&r, out[1], 20, NULL) == IO_ERR_FAILED_WRITE);
+    T_READER_ASSERT_FOR_READER(r.pos == 0, &r);
+    signal(SIGPIPE, prev);
+
+    T_READER_FREE(&r);
+    close(out[1]);
+    return passed;
+}
+
+bool t_reader_case_forward_stops_when_sink_makes_no_progress(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(16, "buffered", 8);
+    T_ASSERT(io_reader_fill(&r, 8) == IO_ERR_OK && io_reader_buffered(&r) == 8);
+    int out[2];
+    if (pipe(out) == -1) T_FATAL("Failed to create pipe");
+
+    t_stuck_fd = out[1];
+    T_ASSERT(io_reader_forward(&r, out[1], 8, NULL) == IO_ERR_FAILED_WRITE);
+    t_stuck_fd = -1;
+    T_READER_ASSERT_FOR_READER(r.pos == 0 && io_reader_buffered(&r) == 8, &r);
+
+    T_READER_FREE(&r);
+    close(out[0]); close(out[1]);
+    return passed;
+}
+
+bool t_reader_case_nreadv_scatters_header_and_body(void) {
+    bool passed = true;
+    char data[40];
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = 'A' + i % 26;
+    IO_Buffer b = T_EMPTY_BUFFER(8);
+    T_MemSource m = {.data = data, .len = sizeof(data), .chunk = 64};
+    IO_Source src = {.read = t_mem_source_read, .readv = t_mem_source_readv, .ctx = &m};
+    IO_Reader r = {0};
+    T_ASSERT(io_reader_init_source(&r, &b, &src) == IO_ERR_OK);
+    T_ASSERT(io_reader_prefetch(&r, 2) == IO_ERR_OK);
+
+    char head[4] = {0}, body[20] = {0};
+    IO_Span iov[3] = {{head, sizeof(head)}, {NULL, 0}, {body, sizeof(body)}};
+    m.calls = 0;
+    T_ASSERT(io_reader_nreadv(&r, iov, 3) == IO_ERR_OK);
+    T_ASSERT(m.calls == 1);
+    T_ASSERT(memcmp(head, data, 4) == 0 && memcmp(body, data + 4, 20) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 24 && r.nread == 32, &r);
+    T_READER_ASSERT_BUFFER_EQ(&r, data + 24, 8);
+
+    // NOTE: Only the buffered bytes are left for the header, then EOF.
+    char tail[16] = {0};
+    iov[0] = (IO_Span){head, 4};
+    iov[1] = (IO_Span){tail, sizeof(tail)};
+    T_ASSERT(io_reader_nreadv(&r, iov, 2) == IO_ERR_PARTIAL);
+    T_ASSERT(memcmp(head, data + 24, 4) == 0 && memcmp(tail, data + 28, 12) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == 40 && r.nread == 40, &r);
+    T_ASSERT(io_reader_nreadv(&r, iov, 2) == IO_ERR_EOF);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_reader_case_nreadv_more_regions_than_one_read_takes(void) {
+    bool passed = true;
+    const char *data = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    IO_Reader r = T_READER_WITH_DATA(4, data, strlen(data));
+
+    enum { N = IO_READV_MAX + 4 };
+    char dest[N] = {0};
+    IO_Span iov[N];
+    for (int i = 0; i < N; i++) iov[i] = (IO_Span){dest + i, 1};
+    T_ASSERT(io_reader_nreadv(&r, iov, N) == IO_ERR_OK);
+    T_ASSERT(memcmp(dest, data, N) == 0);
+    T_READER_ASSERT_FOR_READER(r.pos == N && r.nread >= r.pos, &r);
+
+    char rest[64] = {0};
+    size_t left = strlen(data) - N;
+    T_ASSERT(io_reader_nread_full(&r, rest, left) == IO_ERR_OK && memcmp(rest, data + N, left) == 0);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
 //////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
 // TODO: Test wrapping peek/read
 #define T_READER_CASE_MAP(XX)                                       \
@@ -245,7 +1241,50 @@ bool t_reader_case_sequence_peek_consume_read_peek_discard(void) {
     XX(7,  discard)                                                 \
     XX(8,  normal_read_partial_from_buffer_plus_fd)                 \
     XX(9,  read_hitting_EOF)                                        \
-    XX(10, sequence_peek_consume_read_peek_discard)
+    XX(10, sequence_peek_consume_read_peek_discard)                 \
+    XX(11, fill_reads_into_buffer)                                  \
+    XX(12, fill_beyond_free_space)                                  \
+    XX(13, fill_rewinds_empty_buffer)                               \
+    XX(14, prefetch_into_empty_buffer)                              \
+    XX(15, fill_across_wrap)                                        \
+    XX(16, prefetch_tops_up_partially_buffered)                     \
+    XX(17, prefetch_all_stops_at_EOF)                               \
+    XX(18, prefetch_all_stops_when_would_block)                     \
+    XX(19, commit_and_consume_spans)                                \
+    XX(20, readline_lf_and_crlf)                                    \
+    XX(21, read_until_copies_wrapped_record)                        \
+    XX(22, read_until_multibyte_delimiter)                          \
+    XX(23, readline_longer_than_maxlen)                             \
+    XX(24, nonblocking_peek_and_read)                               \
+    XX(25, nonblocking_readline_resumes)                            \
+    XX(26, custom_source)                                           \
+    XX(27, custom_source_readv_fills_wrapped_buffer)                \
+    XX(28, mmap_serves_file_from_mapping)                           \
+    XX(29, mmap_starts_at_current_offset)                           \
+    XX(30, mmap_rejects_pipe)                                       \
+    XX(31, nread_full_reads_past_capacity)                          \
+    XX(32, nread_full_reads_ahead_into_buffer)                      \
+    XX(33, nread_full_resumes_when_would_block)                     \
+    XX(34, readahead_batches_small_reads)                           \
+    XX(35, readahead_shrinks_on_short_reads)                        \
+    XX(36, growable_buffer_fits_long_line)                          \
+    XX(37, pooled_buffer_reattaches_on_read)                        \
+    XX(38, read_frame_views_payload_in_buffer)                      \
+    XX(39, read_frame_wrapped_payload_in_two_spans)                 \
+    XX(40, read_frame_larger_than_buffer_reads_into_dest)           \
+    XX(41, read_frame_varint)                                       \
+    XX(42, read_records_takes_all_buffered_records)                 \
+    XX(43, read_records_copies_wrapped_record)                      \
+    XX(44, read_frames_takes_all_buffered_frames)                   \
+    XX(45, forward_buffered_then_pipe)                              \
+    XX(46, forward_file_to_file)                                    \
+    XX(47, forward_socket_through_pipe)                             \
+    XX(48, nreadv_scatters_header_and_body)                         \
+    XX(49, nreadv_more_regions_than_one_read_takes)                 \
+    XX(50, forward_writes_pending_before_buffered)                  \
+    XX(51, forward_reports_destination_errors)                      \
+    XX(52, mmap_readline_without_trailing_newline)                  \
+    XX(53, forward_stops_when_sink_makes_no_progress)
 
 
 void t_buffer_run(void) {
@@ -0,0 +1,157 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_SERVER
+#define IO_IMPL
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_SERVER_PASSED = 0, T_SERVER_FAILED = 0;
+
+/**
+ * Line echo connection served by a worker, with buffers from the worker's
+ * pool.
+ */
+typedef struct {
+    IO_Conn c;
+    IO_Reader r;
+    IO_Writer w;
+    IO_Buffer rb, wb;
+} T_EchoConn;
+
+static atomic_int t_accepted, t_closed, t_stopped, t_unpinned;
+
+size_t t_echo_on_data(IO_Loop *l, IO_Conn *c, const IO_Span *spans, size_t nspans) {
+    (void)l;
+    size_t n = 0;
+    for (size_t i = 0; i < nspans; i++) {
+        io_writer_write(c->w, spans[i].ptr, spans[i].len);
+        n += spans[i].len;
+    }
+    return n;
+}
+
+void t_echo_on_close(IO_Loop *l, IO_Conn *c, IO_Err err) {
+    (void)l;
+    (void)err;
+    T_EchoConn *e = c->ctx;
+    close(e->r.fd);
+    io_buffer_free(&e->rb);
+    io_buffer_free(&e->wb);
+    free(e);
+    atomic_fetch_add(&t_closed, 1);
+}
+
+void t_echo_on_accept(IO_Worker *w, int fd) {
+    cpu_set_t set;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0 || CPU_COUNT(&set) != 1 ||
+        !CPU_ISSET(w->index % (size_t)ncpu, &set)) {
+        atomic_fetch_add(&t_unpinned, 1);
+    }
+    T_EchoConn *e = calloc(1, sizeof(T_EchoConn));
+    if (e == NULL) T_FATAL("Failed to allocate connection");
+    if (io_buffer_init_pooled(&e->rb, &w->pool) != IO_ERR_OK) T_FATAL("Failed to get buffer");
+    if (io_buffer_init_pooled(&e->wb, &w->pool) != IO_ERR_OK) T_FATAL("Failed to get buffer");
+    io_reader_init(&e->r, &e->rb, fd);
+    io_writer_init(&e->w, &e->wb, fd);
+    e->c = (IO_Conn){.r = &e->r, .w = &e->w, .on_data = t_echo_on_data, .on_close = t_echo_on_close, .ctx = e};
+    if (io_loop_add(&w->loop, &e->c) != IO_ERR_OK) T_FATAL("Failed to watch connection");
+    atomic_fetch_add(&t_accepted, 1);
+}
+
+void t_echo_on_stop(IO_Worker *w) {
+    (void)w;
+    atomic_fetch_add(&t_stopped, 1);
+}
+
+void *t_server_thread(void *arg) {
+    IO_Server *s = arg;
+    static IO_Err err;
+    err = io_server_run(s);
+    return &err;
+}
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_server_case_workers_share_port_and_echo(void) {
+    bool passed = true;
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = 0};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    IO_ServerConfig cfg = {
+        .addr = (struct sockaddr *)&addr, .addrlen = sizeof(addr),
+        .nworkers = 4, .pin = true, .buffer_cap = 256, .pool_blocks = 8,
+        .on_accept = t_echo_on_accept, .on_stop = t_echo_on_stop,
+    };
+    IO_Server s;
+    T_ASSERT(io_server_init(&s, &cfg) == IO_ERR_OK);
+    T_ASSERT(s.nworkers == 4);
+    struct sockaddr_in *bound = (struct sockaddr_in *)&s.addr;
+    T_ASSERT(bound->sin_port != 0);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, t_server_thread, &s) != 0) T_FATAL("Failed to create thread");
+
+    int clients[16];
+    for (int i = 0; i < 16; i++) {
+        clients[i] = socket(AF_INET, SOCK_STREAM, 0);
+        T_ASSERT(connect(clients[i], (struct sockaddr *)bound, sizeof(*bound)) == 0);
+    }
+    size_t echoed = 0;
+    for (int i = 0; i < 16; i++) {
+        char msg[16], reply[16] = {0};
+        int len = snprintf(msg, sizeof(msg), "client %d\n", i);
+        write(clients[i], msg, len);
+        size_t got = 0;
+        while (got < (size_t)len) {
+            ssize_t n = read(clients[i], reply + got, sizeof(reply) - got);
+            if (n <= 0) break;
+            got += n;
+        }
+        if (got == (size_t)len && memcmp(msg, reply, len) == 0) echoed++;
+    }
+    T_ASSERT(echoed == 16);
+
+    for (int i = 0; i < 16; i++) close(clients[i]);
+    for (int i = 0; i < 1000 && atomic_load(&t_closed) < 16; i++) usleep(1000);
+    T_ASSERT(atomic_load(&t_accepted) == 16 && atomic_load(&t_closed) == 16);
+    T_ASSERT(atomic_load(&t_unpinned) == 0);
+
+    T_ASSERT(io_server_stop(&s) == IO_ERR_OK);
+    IO_Err *err;
+    pthread_join(thread, (void **)&err);
+    T_ASSERT(*err == IO_ERR_OK);
+    T_ASSERT(atomic_load(&t_stopped) == 4);
+
+    io_server_free(&s);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_SERVER_CASE_MAP(XX)                                       \
+    XX(1,  workers_share_port_and_echo)
+
+void t_server_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_server_case_##name();                           \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_SERVER_PASSED++; else T_SERVER_FAILED++;          \
+    } while(0);
+
+    T_SERVER_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_SERVER_PASSED, T_SERVER_PASSED + T_SERVER_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_server_run();
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_IMPL
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_SPSC_PASSED = 0, T_SPSC_FAILED = 0;
+
+#define T_SPSC_TRANSFER_SZ (4 << 20)
+
+/**
+ * Producer side of t_spsc_case_two_threads_transfer(): publishes
+ * `T_SPSC_TRANSFER_SZ` bytes of a known pattern in batches of varying size.
+ */
+void *t_spsc_producer(void *arg) {
+    IO_SpscBuffer *q = arg;
+    size_t sent = 0, batch = 1;
+    while (sent < T_SPSC_TRANSFER_SZ) {
+        IO_Span spans[2];
+        size_t nspans = io_spsc_reserve_spans(q, spans), n = 0;
+        for (size_t i = 0; i < nspans; i++) {
+            size_t len = MIN(MIN(spans[i].len, batch - n), T_SPSC_TRANSFER_SZ - sent - n);
+            for (size_t j = 0; j < len; j++) spans[i].ptr[j] = (char)((sent + n + j) % 251);
+            n += len;
+        }
+        io_spsc_publish(q, n);
+        sent += n;
+        batch = batch % 97 + 1;
+    }
+    return NULL;
+}
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_spsc_case_init_empty(void) {
+    bool passed = true;
+    IO_SpscBuffer q;
+    T_ASSERT(io_spsc_init(&q, 8) == IO_ERR_OK);
+    T_ASSERT(io_spsc_len(&q) == 0);
+    T_ASSERT(io_spsc_nadvance(&q, 4) == 0);
+    T_ASSERT(((size_t)&q.tail - (size_t)&q.head) >= IO_CACHE_LINE);
+
+    io_spsc_free(&q);
+    return passed;
+}
+
+bool t_spsc_case_append_and_nspit_across_wrap(void) {
+    bool passed = true;
+    IO_SpscBuffer q;
+    T_ASSERT(io_spsc_init(&q, 6) == IO_ERR_OK);
+
+    char dest[7] = {0};
+    T_ASSERT(io_spsc_append(&q, "ABCDE", 5) == IO_ERR_OK);
+    T_ASSERT(io_spsc_append(&q, "FG", 2) == IO_ERR_OOB);
+    T_ASSERT(io_spsc_nadvance(&q, 3) == 3);
+    T_ASSERT(io_spsc_append(&q, "FGHI", 4) == IO_ERR_OK);
+    T_ASSERT(io_spsc_len(&q) == 6);
+    T_ASSERT(io_spsc_append(&q, "J", 1) == IO_ERR_OOB);
+
+    T_ASSERT(io_spsc_nspit(&q, dest, 7) == IO_ERR_OOB);
+    T_ASSERT(io_spsc_nspit(&q, dest, 6) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "DEFGHI", 6) == 0);
+
+    IO_Span spans[2];
+    T_ASSERT(io_spsc_peek_spans(&q, spans) == 2);
+    T_ASSERT(spans[0].ptr == q.buf + 3 && spans[0].len == 4);
+    T_ASSERT(spans[1].ptr == q.buf && spans[1].len == 2);
+    T_ASSERT(io_spsc_nadvance(&q, 10) == 6);
+    T_ASSERT(io_spsc_len(&q) == 0);
+
+    io_spsc_free(&q);
+    return passed;
+}
+
+bool t_spsc_case_reserve_and_publish_batch(void) {
+    bool passed = true;
+    IO_SpscBuffer q;
+    T_ASSERT(io_spsc_init(&q, 6) == IO_ERR_OK);
+    T_ASSERT(io_spsc_append(&q, "0123", 4) == IO_ERR_OK);
+    T_ASSERT(io_spsc_nadvance(&q, 4) == 4);
+
+    IO_Span spans[2];
+    T_ASSERT(io_spsc_reserve_spans(&q, spans) == 2);
+    T_ASSERT(spans[0].ptr == q.buf + 4 && spans[0].len == 3);
+    T_ASSERT(spans[1].ptr == q.buf && spans[1].len == 3);
+    memcpy(spans[0].ptr, "abc", 3);
+    memcpy(spans[1].ptr, "de", 2);
+    T_ASSERT(io_spsc_len(&q) == 0);
+
+    T_ASSERT(io_spsc_publish(&q, 7) == IO_ERR_OOB);
+    T_ASSERT(io_spsc_publish(&q, 5) == IO_ERR_OK);
+    char dest[5] = {0};
+    T_ASSERT(io_spsc_nspit(&q, dest, 5) == IO_ERR_OK);
+    T_ASSERT(strncmp(dest, "abcde", 5) == 0);
+
+    io_spsc_free(&q);
+    return passed;
+}
+
+bool t_spsc_case_two_threads_transfer(void) {
+    bool passed = true;
+    IO_SpscBuffer q;
+    T_ASSERT(io_spsc_init(&q, 1000) == IO_ERR_OK);
+
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, t_spsc_producer, &q) != 0) T_FATAL("Failed to create thread");
+
+    size_t received = 0, mismatches = 0;
+    while (received < T_SPSC_TRANSFER_SZ) {
+        IO_Span spans[2];
+        size_t nspans = io_spsc_peek_spans(&q, spans), n = 0;
+        for (size_t i = 0; i < nspans; i++) {
+            for (size_t j = 0; j < spans[i].len; j++) {
+                if (spans[i].ptr[j] != (char)((received + n + j) % 251)) mismatches++;
+            }
+            n += spans[i].len;
+        }
+        received += io_spsc_nadvance(&q, n);
+    }
+    pthread_join(producer, NULL);
+    T_ASSERT(mismatches == 0);
+    T_ASSERT(received == T_SPSC_TRANSFER_SZ && io_spsc_len(&q) == 0);
+
+    io_spsc_free(&q);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_SPSC_CASE_MAP(XX)                                         \
+    XX(1,  init_empty)                                              \
+    XX(2,  append_and_nspit_across_wrap)                            \
+    XX(3,  reserve_and_publish_batch)                               \
+    XX(4,  two_threads_transfer)
+
+void t_spsc_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_spsc_case_##name();                             \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_SPSC_PASSED++; else T_SPSC_FAILED++;              \
+    } while(0);
+
+    T_SPSC_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_SPSC_PASSED, T_SPSC_PASSED + T_SPSC_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_spsc_run();
+    return 0;
+}
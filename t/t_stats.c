@@ -0,0 +1,120 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_IMPL
+#define IO_STATS
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_STATS_PASSED = 0, T_STATS_FAILED = 0;
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_stats_case_counts_reads_short_reads_and_eof(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(16, "0123456789", 10);
+    IO_ReaderStats st;
+
+    char dest[16] = {0};
+    T_ASSERT(io_reader_npeek(&r, dest, 4) == IO_ERR_OK);
+    T_ASSERT(io_reader_stats(&r, &st) == IO_ERR_OK);
+    T_ASSERT(st.nreads == 1 && st.nbytes == 4 && st.nshort == 0);
+
+    T_ASSERT(io_reader_prefetch(&r, 16) == IO_ERR_PARTIAL);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_EOF);
+    T_ASSERT(io_reader_stats(&r, &st) == IO_ERR_OK);
+    T_ASSERT(st.nreads == 3 && st.nbytes == 10);
+    T_ASSERT(st.nshort == 1 && st.neof == 1 && st.nagain == 0);
+    T_ASSERT(st.b.peak == 10);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_stats_case_counts_again(void) {
+    bool passed = true;
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    IO_Reader r = t_new_reader(8, fds[0]);
+    IO_ReaderStats st;
+
+    T_ASSERT(io_reader_fill(&r, 4) == IO_ERR_AGAIN);
+    T_ASSERT(io_reader_stats(&r, &st) == IO_ERR_OK);
+    T_ASSERT(st.nreads == 1 && st.nagain == 1 && st.nbytes == 0);
+
+    T_READER_FREE(&r);
+    close(fds[1]);
+    return passed;
+}
+
+bool t_stats_case_counts_copies_wraps_and_peak(void) {
+    bool passed = true;
+    IO_Buffer b = T_EMPTY_BUFFER(8);
+    IO_Reader r = {0};
+    io_reader_init(&r, &b, -1);
+    IO_ReaderStats st;
+    b.start = b.end = b.buf + 6;
+
+    T_ASSERT(io_buffer_append(&b, "ABCD", 4) == IO_ERR_OK);
+    char dest[4];
+    T_ASSERT(io_buffer_nspit(&b, dest, 4) == IO_ERR_OK);
+    io_buffer_nadvance(&b, 4);
+    T_ASSERT(io_buffer_append(&b, "EF", 2) == IO_ERR_OK);
+
+    T_ASSERT(io_reader_stats(&r, &st) == IO_ERR_OK);
+    T_ASSERT(st.b.ncopied == 10);
+    T_ASSERT(st.b.nwraps == 1);
+    T_ASSERT(st.b.peak == 4);
+    T_ASSERT(st.nreads == 0);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_stats_case_reset(void) {
+    bool passed = true;
+    IO_Reader r = T_READER_WITH_DATA(16, "0123456789", 10);
+    IO_ReaderStats st;
+
+    T_ASSERT(io_reader_prefetch(&r, 8) == IO_ERR_OK);
+    T_ASSERT(io_reader_nconsume(&r, NULL, 6) == IO_ERR_OK);
+    T_ASSERT(io_reader_stats_reset(&r) == IO_ERR_OK);
+    T_ASSERT(io_reader_stats(&r, &st) == IO_ERR_OK);
+    T_ASSERT(st.nreads == 0 && st.nbytes == 0 && st.b.ncopied == 0);
+    T_ASSERT(st.b.peak == 2);
+
+    T_ASSERT(io_reader_prefetch(&r, 4) == IO_ERR_OK);
+    T_ASSERT(io_reader_stats(&r, &st) == IO_ERR_OK);
+    T_ASSERT(st.nreads == 1 && st.nbytes == 2 && st.b.peak == 4);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_STATS_CASE_MAP(XX)                                        \
+    XX(1,  counts_reads_short_reads_and_eof)                        \
+    XX(2,  counts_again)                                            \
+    XX(3,  counts_copies_wraps_and_peak)                            \
+    XX(4,  reset)
+
+void t_stats_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_stats_case_##name();                            \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_STATS_PASSED++; else T_STATS_FAILED++;            \
+    } while(0);
+
+    T_STATS_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_STATS_PASSED, T_STATS_PASSED + T_STATS_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_stats_run();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_IMPL
+#define IO_TRACE
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_TRACE_PASSED = 0, T_TRACE_FAILED = 0;
+
+#define T_TRACE_THREADS 4
+#define T_TRACE_RECORDS 100000
+
+void *t_trace_recorder(void *arg) {
+    IO_Histogram *h = arg;
+    for (uint64_t i = 1; i <= T_TRACE_RECORDS; i++) io_histogram_record(h, i);
+    return NULL;
+}
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_trace_case_histogram_percentiles(void) {
+    bool passed = true;
+    static IO_Histogram h;
+    io_histogram_reset(&h);
+    T_ASSERT(io_histogram_percentile(&h, 50.0) == 0);
+
+    for (uint64_t v = 1; v <= 1000; v++) io_histogram_record(&h, v);
+    uint64_t p50 = io_histogram_percentile(&h, 50.0);
+    uint64_t p99 = io_histogram_percentile(&h, 99.0);
+    T_ASSERT(p50 >= 500 && p50 <= 500 + 500 / 16);
+    T_ASSERT(p99 >= 990 && p99 <= 1000);
+    T_ASSERT(io_histogram_percentile(&h, 100.0) == 1000);
+    T_ASSERT(io_histogram_percentile(&h, 0.5) == 5);
+
+    io_histogram_reset(&h);
+    io_histogram_record(&h, UINT64_MAX);
+    T_ASSERT(io_histogram_percentile(&h, 50.0) == UINT64_MAX);
+
+    return passed;
+}
+
+bool t_trace_case_histogram_concurrent_record(void) {
+    bool passed = true;
+    static IO_Histogram h;
+    io_histogram_reset(&h);
+
+    pthread_t threads[T_TRACE_THREADS];
+    for (int i = 0; i < T_TRACE_THREADS; i++) pthread_create(&threads[i], NULL, t_trace_recorder, &h);
+    for (int i = 0; i < T_TRACE_THREADS; i++) pthread_join(threads[i], NULL);
+
+    T_ASSERT(h.count == (uint64_t)T_TRACE_THREADS * T_TRACE_RECORDS);
+    T_ASSERT(h.max == T_TRACE_RECORDS);
+    uint64_t total = 0;
+    for (size_t i = 0; i < IO_HISTOGRAM_BUCKETS; i++) total += h.buckets[i];
+    T_ASSERT(total == h.count);
+
+    return passed;
+}
+
+bool t_trace_case_reader_records_reads_and_copies(void) {
+    bool passed = true;
+    static IO_Histogram reads, copies;
+    io_histogram_reset(&reads);
+    io_histogram_reset(&copies);
+    IO_Reader r = T_READER_WITH_DATA(16, "Hello, World!", 13);
+
+    T_ASSERT(io_reader_trace(&r, IO_TRACE_READ, &reads) == IO_ERR_OK);
+    T_ASSERT(io_reader_trace(&r, IO_TRACE_COPY, &copies) == IO_ERR_OK);
+    T_ASSERT(io_reader_trace(&r, IO_TRACE_COUNT, &copies) == IO_ERR_OOB);
+
+    char dest[16] = {0};
+    T_ASSERT(io_reader_prefetch(&r, 13) == IO_ERR_OK);
+    T_ASSERT(io_reader_npeek(&r, dest, 5) == IO_ERR_OK);
+    T_ASSERT(io_reader_nread(&r, dest, 13) == IO_ERR_OK);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_EOF);
+    T_ASSERT(reads.count == 2);
+    T_ASSERT(copies.count == 2);
+
+    T_ASSERT(io_reader_trace(&r, IO_TRACE_READ, NULL) == IO_ERR_OK);
+    T_ASSERT(io_reader_fill(&r, 1) == IO_ERR_EOF);
+    T_ASSERT(reads.count == 2);
+
+    T_READER_FREE(&r);
+    return passed;
+}
+
+bool t_trace_case_dump(void) {
+    bool passed = true;
+    static IO_Histogram h;
+    io_histogram_reset(&h);
+    io_histogram_record(&h, 1);
+    io_histogram_record(&h, 2);
+    io_histogram_record(&h, 3);
+
+    int fds[2];
+    if (pipe(fds) == -1) T_FATAL("Failed to create pipe");
+    T_ASSERT(io_histogram_dump(&h, "read", fds[1]) == IO_ERR_OK);
+    close(fds[1]);
+
+    char line[128] = {0};
+    T_ASSERT(read(fds[0], line, sizeof(line) - 1) > 0);
+    T_ASSERT(strcmp(line, "read count=3 mean=2 p50=2 p99=3 p999=3 max=3\n") == 0);
+
+    close(fds[0]);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_TRACE_CASE_MAP(XX)                                        \
+    XX(1,  histogram_percentiles)                                   \
+    XX(2,  histogram_concurrent_record)                             \
+    XX(3,  reader_records_reads_and_copies)                         \
+    XX(4,  dump)
+
+void t_trace_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_trace_case_##name();                            \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_TRACE_PASSED++; else T_TRACE_FAILED++;            \
+    } while(0);
+
+    T_TRACE_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_TRACE_PASSED, T_TRACE_PASSED + T_TRACE_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_trace_run();
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define IO_IMPL
+#define _DEBUG
+#include "../io.h"
+#include "_helpers.c"
+
+static long T_WRITER_PASSED = 0, T_WRITER_FAILED = 0;
+
+#define T_WRITER_ASSERT_FOR_WRITER(expr, w) do {                \
+        bool result = T_ASSERT(expr);                           \
+        if (!result) printf("INFO: %s\n", t_writer_repr(w));    \
+    } while(0)
+
+//////////////////// BEGIN: TEST CASES IMPLEMENTATION ////////////////////
+bool t_writer_case_init_empty(void) {
+    bool passed = true;
+    IO_Buffer b = T_EMPTY_BUFFER(8);
+    IO_Writer w = {0};
+
+    T_ASSERT(io_writer_init(&w, &b, 1) == IO_ERR_OK);
+    T_ASSERT(w.b->cap == 8);
+    T_ASSERT(w.nwritten == 0 && w.nflushed == 0);
+    T_ASSERT(io_writer_pending(&w) == 0);
+
+    io_buffer_free(&b);
+    return passed;
+}
+
+bool t_writer_case_small_writes_are_coalesced(void) {
+    bool passed = true;
+    int fds[2];
+    IO_Writer w = t_new_writer_with_pipe(8, fds);
+
+    T_ASSERT(io_writer_write(&w, "AB", 2) == IO_ERR_OK);
+    T_ASSERT(io_writer_write(&w, "CDE", 3) == IO_ERR_OK);
+    T_WRITER_ASSERT_FOR_WRITER(w.nwritten == 5 && w.nflushed == 0, &w);
+
+    char dest[16] = {0};
+    T_ASSERT(t_drain(fds[0], dest, sizeof(dest)) == 0);
+
+    T_ASSERT(io_writer_flush(&w) == IO_ERR_OK);
+    T_WRITER_ASSERT_FOR_WRITER(w.nwritten == 5 && w.nflushed == 5, &w);
+    T_ASSERT(io_writer_pending(&w) == 0);
+    T_ASSERT(t_drain(fds[0], dest, sizeof(dest)) == 5);
+    T_ASSERT(strcmp(dest, "ABCDE") == 0);
+
+    T_WRITER_FREE(&w, fds);
+    return passed;
+}
+
+bool t_writer_case_write_exceeding_free_space_bypasses_buffer(void) {
+    bool passed = true;
+    int fds[2];
+    IO_Writer w = t_new_writer_with_pipe(4, fds);
+
+    T_ASSERT(io_writer_write(&w, "AB", 2) == IO_ERR_OK);
+    T_ASSERT(io_writer_write(&w, "CDEFGHIJ", 8) == IO_ERR_OK);
+    T_WRITER_ASSERT_FOR_WRITER(w.nwritten == 10 && w.nflushed == 10, &w);
+    T_ASSERT(io_writer_pending(&w) == 0);
+
+    char dest[16] = {0};
+    T_ASSERT(t_drain(fds[0], dest, sizeof(dest)) == 10);
+    T_ASSERT(strcmp(dest, "ABCDEFGHIJ") == 0);
+
+    T_WRITER_FREE(&w, fds);
+    return passed;
+}
+
+bool t_writer_case_flush_wrapped_buffer(void) {
+    bool passed = true;
+    int fds[2];
+    IO_Writer w = t_new_writer_with_pipe(6, fds);
+    w.b->start = w.b->end = w.b->buf + 5;
+
+    T_ASSERT(io_writer_write(&w, "ABCD", 4) == IO_ERR_OK);
+    T_ASSERT(w.b->end < w.b->start);
+    T_ASSERT(io_writer_flush(&w) == IO_ERR_OK);
+
+    char dest[16] = {0};
+    T_ASSERT(t_drain(fds[0], dest, sizeof(dest)) == 4);
+    T_ASSERT(strcmp(dest, "ABCD") == 0);
+
+    T_WRITER_FREE(&w, fds);
+    return passed;
+}
+
+bool t_writer_case_nonblocking_write_when_pipe_is_full(void) {
+    bool passed = true;
+    int fds[2];
+    IO_Writer w = t_new_writer_with_pipe(16, fds);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    size_t big_len = 1 << 20;
+    char *big = malloc(big_len);
+    memset(big, 'x', big_len);
+
+    T_ASSERT(io_writer_write(&w, big, big_len) == IO_ERR_AGAIN);
+    size_t accepted = w.nwritten;
+    T_WRITER_ASSERT_FOR_WRITER(accepted > 0 && accepted < big_len, &w);
+    T_WRITER_ASSERT_FOR_WRITER(io_writer_pending(&w) == 16, &w);
+    T_ASSERT(io_writer_flush(&w) == IO_ERR_AGAIN);
+
+    char *dest = malloc(big_len);
+    size_t total = t_drain(fds[0], dest, big_len);
+    T_ASSERT(io_writer_flush(&w) == IO_ERR_OK);
+    total += t_drain(fds[0], dest + total, big_len - total);
+    T_WRITER_ASSERT_FOR_WRITER(total == accepted && w.nflushed == accepted, &w);
+
+    free(dest);
+    free(big);
+    T_WRITER_FREE(&w, fds);
+    return passed;
+}
+//////////////////// END:   TEST CASES IMPLEMENTATION ////////////////////
+
+#define T_WRITER_CASE_MAP(XX)                                       \
+    XX(1,  init_empty)                                              \
+    XX(2,  small_writes_are_coalesced)                              \
+    XX(3,  write_exceeding_free_space_bypasses_buffer)              \
+    XX(4,  flush_wrapped_buffer)                                    \
+    XX(5,  nonblocking_write_when_pipe_is_full)
+
+void t_writer_run(void) {
+#define XX(num, name) do {                                              \
+        printf("\tRunning  testcase \"%s\"\n", #name);                  \
+        bool result = t_writer_case_##name();                           \
+        printf("\tFinished testcase \"%s\": %s\n", #name, (result) ? "PASSED" : "FAILED"); \
+        if (result) T_WRITER_PASSED++; else T_WRITER_FAILED++;          \
+    } while(0);
+
+    T_WRITER_CASE_MAP(XX);
+#undef XX
+    printf("INFO: Passed: %ld/%ld; Assertions %ld/%ld\n", T_WRITER_PASSED, T_WRITER_PASSED + T_WRITER_FAILED, T_ASSERTIONS_PASSED, T_ASSERTIONS_PASSED + T_ASSERTIONS_FAILED);
+}
+
+int main(void) {
+    t_writer_run();
+    return 0;
+}